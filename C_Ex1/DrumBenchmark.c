@@ -0,0 +1,369 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include <unistd.h>
+#include "conv.h"
+#include "DrumExperiment.h"
+
+/**
+ * @brief The prefix of the benchmark argument that sets the most multiply-adds a run may take.
+ */
+#define BUDGET_ARGUMENT "--budget="
+
+/**
+ * @brief Defines the default number of multiply-adds a benchmark run may take.
+ */
+#define DEFAULT_WORK_BUDGET 250000000LL
+
+/**
+ * @brief Defines the largest error of a benchmark run, relative to the largest reference value.
+ */
+#define BENCHMARK_TOLERANCE 1e-9
+
+/**
+ * @brief Defines the seed of the synthetic signals, so every benchmark convolves the same ones.
+ */
+#define BENCHMARK_SEED 27003
+
+/**
+ * @brief Defines the benchmark engine that runs the passes with singleConvolution.
+ */
+#define BENCHMARK_DIRECT 0
+
+/**
+ * @brief Defines the benchmark engine that runs the vectorized passes on one thread.
+ */
+#define BENCHMARK_SIMD 1
+
+/**
+ * @brief Defines the benchmark engine that runs the vectorized passes on many threads.
+ */
+#define BENCHMARK_THREADED 2
+
+/**
+ * @brief Defines the benchmark engine that transforms once.
+ */
+#define BENCHMARK_FFT 3
+
+/**
+ * @brief Defines the benchmark engine that scatters the taps of h.
+ */
+#define BENCHMARK_SPARSE 4
+
+/**
+ * @brief Defines the number of benchmark engines.
+ */
+#define NUMBER_OF_BENCHMARK_ENGINES 5
+
+/**
+ * @brief A synthetic kernel of the benchmark
+ */
+typedef struct BenchmarkKernel
+{
+    const char *name; /**< the name of the kernel in the report */
+    int hSize; /**< the number of samples in the kernel */
+    int stride; /**< the distance between the non zero samples of the kernel */
+} BenchmarkKernel;
+
+/**
+ * @brief the sizes of the synthetic g signals
+ */
+const int benchmarkSignalSizes[] = {100, 1000, 10000, 100000, 1000000, 10000000};
+
+/**
+ * @brief the numbers of convolutions of the benchmark
+ */
+const int benchmarkIterations[] = {1, 10, 100, 1000, 10000, 100000, 1000000};
+
+/**
+ * @brief the synthetic kernels of the benchmark, one dense pair of sizes and an impulse train
+ */
+const BenchmarkKernel benchmarkKernels[] = {{"dense16", 16, 1}, {"dense256", 256, 1}, {"sparse256", 256, 16}};
+
+/**
+ * @brief the names of the benchmark engines, indexed by their defines
+ */
+const char *benchmarkEngineNames[NUMBER_OF_BENCHMARK_ENGINES] = {"direct", "simd", "threaded", "fft", "sparse"};
+
+/**
+ * @brief Runs every engine on every synthetic case that fits the budget and prints a report row
+ * for every run. The direct runs, or the simd ones where the direct ones are over the budget, are
+ * the reference the other runs are checked against.
+ * @param budget the most multiply-adds a run may take
+ * @param threads the number of threads of the threaded engine
+ * @return EXIT_FAILURE if a run failed or missed the reference, SUCCESSFUL_EXIT_CODE otherwise.
+ */
+int runBenchmark(long long budget, int threads);
+
+/**
+ * @brief Runs the engines on one synthetic case and prints their rows
+ * @param g the synthetic g signal
+ * @param gSize the number of samples in g
+ * @param kernel the synthetic kernel
+ * @param n the number of convolutions
+ * @param budget the most multiply-adds a run may take
+ * @param threads the number of threads of the threaded engine
+ * @param skipped will be increased by the number of runs over the budget
+ * @return ALLOCATION_ERROR if the buffers could not be allocated, INPUT_ERROR if a run missed the
+ * reference, CORRECT_INPUT otherwise.
+ */
+int benchmarkCase(const double *g, int gSize, const BenchmarkKernel *kernel, int n, long long budget,
+                  int threads, int *skipped);
+
+/**
+ * @brief Returns the number of multiply-adds that a benchmark engine schedules, like the stats count them
+ * @param benchmarkEngine the benchmark engine
+ * @param kernel the kernel
+ * @param n the number of convolutions
+ */
+double estimateMultiplyAdds(int benchmarkEngine, const KernelPlan *kernel, int n);
+
+/**
+ * @brief Applies the convolutions with a benchmark engine
+ * @param benchmarkEngine the benchmark engine
+ * @param experiment the experiment
+ * @param resultArray the array that will contain the result of the convolution
+ * @param threads the number of threads of the threaded engine
+ * @return the result of the engine.
+ */
+int applyBenchmarkEngine(int benchmarkEngine, Experiment *experiment, double *resultArray, int threads);
+
+/**
+ * @brief Fills an array with random samples in [0, 1) at every stride-th index of a range, and zeroes
+ * the rest
+ * @param array the array
+ * @param arraySize the number of samples in the array
+ * @param first the first index of the range
+ * @param last the last index of the range
+ * @param stride the distance between the non zero samples
+ */
+void fillSynthetic(double *array, int arraySize, int first, int last, int stride);
+
+
+
+/**
+ * @brief The main method of the benchmark.
+ */
+int main(int argc, char *argv[])
+{
+    long long budget = DEFAULT_WORK_BUDGET;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = (cpus > 1 && cpus < INT_MAX) ? (int) cpus : 1;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strncmp(argv[i], BUDGET_ARGUMENT, strlen(BUDGET_ARGUMENT)) == 0)
+        {
+            char *end = NULL;
+            char *value = argv[i] + strlen(BUDGET_ARGUMENT);
+            budget = strtoll(value, &end, 10);
+            if (end != value && *end == '\0' && budget > 0)
+            {
+                continue;
+            }
+        }
+        else if (strncmp(argv[i], THREADS_ARGUMENT, strlen(THREADS_ARGUMENT)) == 0 &&
+                 parsePositiveArgument(argv[i] + strlen(THREADS_ARGUMENT), &threads) == CORRECT_INPUT)
+        {
+            continue;
+        }
+        fprintf(stderr, "Usage: DrumBenchmark [--budget=<multiply-adds>] [--threads=<count>]\n");
+        return EXIT_FAILURE;
+    }
+    return runBenchmark(budget, threads);
+}
+
+
+int runBenchmark(long long budget, int threads)
+{
+    int signalsCount = sizeof(benchmarkSignalSizes) / sizeof(benchmarkSignalSizes[0]);
+    int iterationsCount = sizeof(benchmarkIterations) / sizeof(benchmarkIterations[0]);
+    int kernelsCount = sizeof(benchmarkKernels) / sizeof(benchmarkKernels[0]);
+    int skipped = 0;
+    int failures = 0;
+    srand(BENCHMARK_SEED);
+    printf("%-9s %9s %8s %-9s %11s %12s %9s %s\n", "kernel", "g", "n", "engine", "seconds", "samples/s",
+           "GFLOP/s", "check");
+    for (int s = 0; s < signalsCount; ++s)
+    {
+        int gSize = benchmarkSignalSizes[s];
+        double *g = (double*) malloc(sizeof(double) * gSize);
+        if (g == NULL)
+        {
+            fprintf(stderr, "ERROR\n");
+            return EXIT_FAILURE;
+        }
+        // the middle half of g holds its samples, so a few passes stay inside the window
+        fillSynthetic(g, gSize, gSize / 4, gSize - gSize / 4 - 1, 1);
+        // like the input of the experiment, h is never longer than g
+        for (int k = 0; k < kernelsCount && benchmarkKernels[k].hSize <= gSize; ++k)
+        {
+            for (int i = 0; i < iterationsCount; ++i)
+            {
+                int result = benchmarkCase(g, gSize, &benchmarkKernels[k], benchmarkIterations[i], budget,
+                                           threads, &skipped);
+                if (result == ALLOCATION_ERROR)
+                {
+                    free(g);
+                    fprintf(stderr, "ERROR\n");
+                    return EXIT_FAILURE;
+                }
+                failures = failures + (result == INPUT_ERROR);
+            }
+        }
+        free(g);
+    }
+    printf("Skipped %d runs over the budget of %lld multiply-adds\n", skipped, budget);
+    if (failures > 0)
+    {
+        printf("%d cases missed the reference\n", failures);
+        return EXIT_FAILURE;
+    }
+    return SUCCESSFUL_EXIT_CODE;
+}
+
+
+int benchmarkCase(const double *g, int gSize, const BenchmarkKernel *kernel, int n, long long budget,
+                  int threads, int *skipped)
+{
+    Experiment experiment;
+    KernelPlan plan;
+    double *h = (double*) malloc(sizeof(double) * (*kernel).hSize);
+    experiment.g = (double*) malloc(sizeof(double) * gSize);
+    plan.h = NULL;
+    plan.reversedTaps = NULL;
+    plan.tapShifts = NULL;
+    plan.tapWeights = NULL;
+    plan.spectra = NULL;
+    plan.spectraCount = 0;
+    int result = (h == NULL || experiment.g == NULL) ? ALLOCATION_ERROR : CORRECT_INPUT;
+    if (result == CORRECT_INPUT)
+    {
+        fillSynthetic(h, (*kernel).hSize, 0, (*kernel).hSize - 1, (*kernel).stride);
+        memcpy(experiment.g, g, sizeof(double) * gSize);
+        experiment.gSize = gSize;
+        result = prepareInputForConvolution(&experiment, &plan, h, (*kernel).hSize);
+    }
+    int windowSize = windowSizeFor(gSize);
+    double *reference = NULL;
+    double *resultArray = (result == CORRECT_INPUT) ? (double*) malloc(sizeof(double) * windowSize) : NULL;
+    if (result == CORRECT_INPUT && resultArray == NULL)
+    {
+        result = ALLOCATION_ERROR;
+    }
+    for (int e = 0; result != ALLOCATION_ERROR && e < NUMBER_OF_BENCHMARK_ENGINES; ++e)
+    {
+        if (e == BENCHMARK_THREADED && threads < 2)
+        {
+            continue;
+        }
+        if (estimateMultiplyAdds(e, &plan, n) > budget)
+        {
+            ++(*skipped);
+            continue;
+        }
+        Stats runStats;
+        memset(&runStats, 0, sizeof(Stats));
+        experiment.n = n;
+        experiment.iterationsRun = n;
+        experiment.stats = &runStats;
+        PhaseTime start = phaseStart();
+        int engineResult = applyBenchmarkEngine(e, &experiment, resultArray, threads);
+        recordPhase(&runStats, PHASE_CONVOLVE, start);
+        if (engineResult != CORRECT_INPUT)
+        {
+            result = ALLOCATION_ERROR;
+            break;
+        }
+        // the fft engine does not drop the mass that leaves the window, so it is checked only while
+        // the n-fold kernel cannot reach past the margins of g
+        const char *check = "reference";
+        if (reference != NULL && (e != BENCHMARK_FFT || (long) n * ((*kernel).hSize - 1) <= gSize / 4))
+        {
+            double largest = 0;
+            for (int j = 0; j < windowSize; ++j)
+            {
+                largest = (fabs(reference[j]) > largest) ? fabs(reference[j]) : largest;
+            }
+            int matches = maxAbsoluteDifference(resultArray, reference, windowSize) <= BENCHMARK_TOLERANCE * largest;
+            check = matches ? "ok" : "FAIL";
+            result = matches ? result : INPUT_ERROR;
+        }
+        else if (reference != NULL)
+        {
+            check = "unwindowed";
+        }
+        else if (e == BENCHMARK_DIRECT || e == BENCHMARK_SIMD)
+        {
+            reference = resultArray;
+            resultArray = (double*) malloc(sizeof(double) * windowSize);
+            result = (resultArray == NULL) ? ALLOCATION_ERROR : result;
+        }
+        else
+        {
+            check = "unchecked";
+        }
+        double seconds = runStats.phases[PHASE_CONVOLVE].wall;
+        seconds = (seconds > 0) ? seconds : 1e-9;
+        printf("%-9s %9d %8d %-9s %11.6f %12.4g %9.3f %s\n", (*kernel).name, gSize, n, benchmarkEngineNames[e],
+               seconds, (double) n * windowSize / seconds, 2.0 * runStats.multiplyAdds / seconds / 1e9, check);
+    }
+    fflush(stdout);
+    free(h);
+    free(experiment.g);
+    free(reference);
+    free(resultArray);
+    freeKernelPlan(&plan);
+    return result;
+}
+
+
+double estimateMultiplyAdds(int benchmarkEngine, const KernelPlan *kernel, int n)
+{
+    switch (benchmarkEngine)
+    {
+        case BENCHMARK_DIRECT:
+            return (double) n * passMultiplyAdds(kernel, 1);
+        case BENCHMARK_FFT:
+        {
+            long transformSize = transformSizeFor(kernel, n);
+            return 4.0 * (3 * transformButterflies(transformSize) +
+                          transformSize * (double) (powerMultiplications(n) + 1));
+        }
+        case BENCHMARK_SPARSE:
+            return (double) n * (*kernel).tapsCount * (*kernel).windowSize;
+        default:
+            return (double) n * passMultiplyAdds(kernel, 0);
+    }
+}
+
+
+int applyBenchmarkEngine(int benchmarkEngine, Experiment *experiment, double *resultArray, int threads)
+{
+    switch (benchmarkEngine)
+    {
+        case BENCHMARK_DIRECT:
+            return nConvolutions(experiment, resultArray);
+        case BENCHMARK_SIMD:
+            return simdConvolutions(experiment, resultArray);
+        case BENCHMARK_THREADED:
+            return threadedConvolutions(experiment, resultArray, threads);
+        case BENCHMARK_FFT:
+            return fftConvolutions(experiment, resultArray);
+        default:
+            return sparseConvolutions(experiment, resultArray);
+    }
+}
+
+
+void fillSynthetic(double *array, int arraySize, int first, int last, int stride)
+{
+    for (int i = 0; i < arraySize; ++i)
+    {
+        array[i] = (i >= first && i <= last && (i - first) % stride == 0) ? (double) rand() / RAND_MAX : 0;
+    }
+    return;
+}
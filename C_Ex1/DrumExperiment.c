@@ -1,20 +1,34 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <complex.h>
+#include <limits.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+/**
+ * @brief Defined when the compiler builds AVX2 functions without -mavx2. They run only on the
+ * processors that report AVX2, the others take the portable loops.
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#   define AVX2_DISPATCH
+#   include <immintrin.h>
+#endif
+#include "conv.h"
+#include "DrumExperiment.h"
 
+#ifndef M_PI
+#   define M_PI 3.14159265358979323846264338327950288
+#endif
 
 
 
-/**
- * @brief Defines an input error output.
- */
-#define INPUT_ERROR -1
-
-/**
- * @brief Defines an input success output.
- */
-#define CORRECT_INPUT 0
 
 /**
  * @brief Defines the minimum iterations allowed.
@@ -31,11 +45,6 @@
  */
 #define NOT_VALID_BOUNDS 0
 
-/**
- * @brief Defines a successful exit code.
- */
-#define SUCCESSFUL_EXIT_CODE 0
-
 /**
  * @brief Defines the maximum length of a number(including the decimal point)
  */
@@ -47,9 +56,9 @@
 #define EXTRA_DECIMAL_POINTS_FOUND 0
 
 /**
- * @brief Defines the upper boundm of input samples.
+ * @brief Defines the minimal size of the convolution window, a longer g signal widens the window.
  */
-#define SAMPLES_UPPER_BOUND 100
+#define SAMPLES_WINDOW_SIZE 100
 
 /**
  * @brief The characters used to separate the input samples.
@@ -57,9 +66,9 @@
 #define INPUT_DIVIDERS " \t\r\n"
 
 /**
- * @brief Defines the maximum line length.
+ * @brief Defines the initial capacity of a growable buffer.
  */
-#define MAX_LINE_LENGTH 1024
+#define INITIAL_BUFFER_CAPACITY 128
 
 /**
  * @bried A small number that the max the required array has to be greater than
@@ -67,298 +76,4360 @@
  */
 #define EPSILON 0.00000001
 
+/**
+ * @brief Defines the number of asterisks in the row of the maximal value of a histogram.
+ */
+#define HISTOGRAM_WIDTH 20
 
+/**
+ * @brief Defines the number of bytes reserved for a row of the output, enough for any double
+ * printed with 3 digits after the decimal point, a label and a full histogram row.
+ */
+#define OUTPUT_ROW_CAPACITY 512
 
+/**
+ * @brief Defines the usage message printed when the program arguments are not valid.
+ */
+#define USAGE_ERROR "Usage: DrumExperiment [--engine=auto|direct|simd|fft|power|exact|sparse] [--input=<path>] " \
+                    "[--format=text|binary] [--output=histogram|csv|binned [--bins=<count>]] [--full] [--stats] [--precision=double|single|mixed [--deviation]] " \
+                    "[--threads=<count>] [--tolerance=<epsilon>] [--stream [--block=<samples>] | --online | --batch | --channels=<count>]\n"
 
 /**
- * @brief the array representing g samples
+ * @brief The prefix of the argument that selects the convolution engine.
  */
-double gArray[SAMPLES_UPPER_BOUND];
+#define ENGINE_ARGUMENT "--engine="
 
 /**
- * @brief the array representing h samples
+ * @brief The prefix of the argument that reads the input from a file instead of stdin.
  */
-double hArray[SAMPLES_UPPER_BOUND];
+#define INPUT_ARGUMENT "--input="
 
 /**
- * @brief the number of samples in the g array
+ * @brief The prefix of the argument that selects the input format.
  */
-int gSize;
+#define FORMAT_ARGUMENT "--format="
 
 /**
- * @brief the number of samples in the h array
+ * @brief The magic bytes at the start of a binary input.
  */
-int hSize;
+#define BINARY_MAGIC "DRUMF64"
 
 /**
- * @brief the number of iterations for which the convolution will be preformed
+ * @brief Defines the size of the header of a binary input: the magic padded to 8 bytes, then
+ * the number of g samples, the number of h samples and n, each a little endian 64 bit integer.
  */
-int n;
+#define BINARY_HEADER_SIZE 32
 
+/**
+ * @brief The prefix of the argument that stops the passes once they converge.
+ */
+#define TOLERANCE_ARGUMENT "--tolerance="
 
+/**
+ * @brief The prefix of the argument that selects the precision of the direct passes.
+ */
+#define PRECISION_ARGUMENT "--precision="
 
+/**
+ * @brief Defines the precision that stores and sums the passes in double.
+ */
+#define PRECISION_DOUBLE 0
 
 /**
- * @brief parses the users input
- * @return INPUT_ERROR if the parsing was unsuccessful, CORRECT_INPUT otherwise.
+ * @brief Defines the precision that stores and sums the passes in float.
  */
-int parseInput();
+#define PRECISION_SINGLE 1
 
 /**
- * @brief Prints the histogram
- * @param array The histogram will be printed according to this array
- * @param arraySize the array size
+ * @brief Defines the precision that stores the passes in float and sums their products in double.
  */
-void histogram(double array[], int arraySize);
+#define PRECISION_MIXED 2
 
 /**
- * @brief Prints Asterisks according to the histogram
- * @param n The number of Asterisks to be printed
+ * @brief Defines the number of precisions.
  */
-void printAsterisks(int n);
+#define NUMBER_OF_PRECISIONS 3
 
 /**
- * @brief Returns the index of the maximum value in a given array
- * @param array The array to search
- * @param arraySize the array size
+ * @brief The argument that checks a reduced precision result against the double passes.
  */
-int indexOfMaxValue(double *array, int arraySize);
+#define DEVIATION_ARGUMENT "--deviation"
 
 /**
- * @brief Rounds the elements of the array to 3 digits after the decimal point
- * @param array The array to round
- * @param arraySize The size of the array
+ * @brief The argument that writes the full linear convolution instead of the window.
  */
-void roundBeforeHistogram(double *array, int arraySize);
+#define FULL_ARGUMENT "--full"
 
 /**
- * @brief parameterization of the convolution bounds with respect to t.
- * @param t The index in the convolution
- * @param size The size of the array
- * @return The actual index after the parameterization.
+ * @brief The argument that reports the stats of a single mode run on stderr.
  */
-int parameterization(int t, int size);
+#define STATS_ARGUMENT "--stats"
+
+/**
+ * @brief The environment variable that reports the stats like STATS_ARGUMENT, unless it is empty or 0.
+ */
+#define STATS_VARIABLE "DRUM_STATS"
+
+/**
+ * @brief The argument that selects the block streaming mode.
+ */
+#define STREAM_ARGUMENT "--stream"
+
+/**
+ * @brief The argument that selects the online mode.
+ */
+#define ONLINE_ARGUMENT "--online"
+
+/**
+ * @brief The argument that selects the batch mode.
+ */
+#define BATCH_ARGUMENT "--batch"
+
+/**
+ * @brief Defines the mode that runs one experiment on a g signal that is read as a whole.
+ */
+#define MODE_SINGLE 0
+
+/**
+ * @brief Defines the mode that streams the g signal block by block.
+ */
+#define MODE_STREAM 1
+
+/**
+ * @brief Defines the mode that runs many experiments against shared kernels.
+ */
+#define MODE_BATCH 2
+
+/**
+ * @brief Defines the mode that convolves many g signals (channels) of one length with one h.
+ */
+#define MODE_CHANNELS 3
+
+/**
+ * @brief Defines the mode that appends every line of g samples to a resident result.
+ */
+#define MODE_ONLINE 4
+
+/**
+ * @brief The prefix of the argument that sets the number of channels and selects the channels mode.
+ */
+#define CHANNELS_ARGUMENT "--channels="
+
+/**
+ * @brief Defines the number of doubles that one AVX2 register holds.
+ */
+#define VECTOR_LANES 4
+
+/**
+ * @brief The tag of a batch line that holds the samples of a new kernel.
+ */
+#define KERNEL_TAG "h"
+
+/**
+ * @brief The tag of a batch line that holds n and the samples of a g signal.
+ */
+#define RECORD_TAG "g"
+
+/**
+ * @brief Defines the number of batch records that are read before they are processed together.
+ */
+#define BATCH_RECORDS_CAPACITY 1024
+
+/**
+ * @brief The prefix of the argument that sets the least number of g samples in a streamed block.
+ */
+#define BLOCK_ARGUMENT "--block="
+
+/**
+ * @brief Defines the default least number of g samples in a streamed block.
+ */
+#define DEFAULT_BLOCK_SIZE 4096
+
+/**
+ * @brief The prefix of the argument that selects how the result is written.
+ */
+#define OUTPUT_ARGUMENT "--output="
+
+/**
+ * @brief Defines the output that prints a histogram row for every sample of the window.
+ */
+#define OUTPUT_HISTOGRAM 0
+
+/**
+ * @brief Defines the output that prints the unrounded values of the window as CSV.
+ */
+#define OUTPUT_CSV 1
+
+/**
+ * @brief Defines the output that prints a histogram of the window summed into bins.
+ */
+#define OUTPUT_BINNED 2
+
+/**
+ * @brief Defines the number of outputs.
+ */
+#define NUMBER_OF_OUTPUTS 3
+
+/**
+ * @brief The prefix of the argument that sets the number of bins of the binned output.
+ */
+#define BINS_ARGUMENT "--bins="
+
+/**
+ * @brief Defines the default number of bins of the binned output.
+ */
+#define DEFAULT_BINS_COUNT 50
+
+/**
+ * @brief Defines that a line or stream of samples has ended.
+ */
+#define END_OF_SAMPLES 1
+
+/**
+ * @brief Defines the direct (time domain) convolution engine, applied pass by pass.
+ */
+#define ENGINE_DIRECT 0
+
+/**
+ * @brief Defines the frequency domain convolution engine.
+ */
+#define ENGINE_FFT 1
+
+/**
+ * @brief Defines the vectorized direct convolution engine, applied pass by pass.
+ */
+#define ENGINE_SIMD 2
+
+/**
+ * @brief Defines that the engine is chosen according to the input.
+ */
+#define ENGINE_AUTO 3
+
+/**
+ * @brief Defines the engine that raises the windowed convolution to the n-th power by repeated squaring.
+ */
+#define ENGINE_POWER 4
+
+/**
+ * @brief Defines the engine that convolves integer counts exactly with number theoretic transforms.
+ */
+#define ENGINE_EXACT 5
+
+/**
+ * @brief Defines the direct engine that iterates over the non zero samples of h only.
+ */
+#define ENGINE_SPARSE 6
+
+/**
+ * @brief Defines the number of engines.
+ */
+#define NUMBER_OF_ENGINES 7
+
+/**
+ * @brief Defines the share of non zero samples in h below which the automatic choice is the sparse engine.
+ */
+#define SPARSE_DENSITY_THRESHOLD 0.25
+
+/**
+ * @brief Defines the number of primes that the exact engine can reconstruct its results from.
+ */
+#define NTT_PRIMES_COUNT 5
+
+/**
+ * @brief Defines how far from an integer a restored count may be, relative to the count.
+ */
+#define INTEGER_TOLERANCE 0.000000001
+
+/**
+ * @brief Defines the largest count that is exactly representable in a double.
+ */
+#define MAXIMAL_EXACT_COUNT 9007199254740992.0
+
+/**
+ * @brief Defines the number of 32 bit limbs of an exact count. The product of the NTT primes is
+ * below 2^146, so twice the largest count still fits in 160 bits.
+ */
+#define EXACT_COUNT_LIMBS 5
+
+/**
+ * @brief Defines the number of significant bits of a double.
+ */
+#define DOUBLE_MANTISSA_BITS 53
+
+/**
+ * @brief Defines the number of partial sums of a dot product, the width of an AVX2 register.
+ */
+#define DOT_PRODUCT_LANES 4
+
+/**
+ * @brief Defines the number of partial sums of a float dot product, the width of an AVX2 register.
+ */
+#define SINGLE_PRODUCT_LANES 8
+
+
+
+
+/**
+ * @brief A non negative integer of EXACT_COUNT_LIMBS limbs, the least significant limb first
+ */
+typedef struct ExactCount
+{
+    uint32_t limbs[EXACT_COUNT_LIMBS]; /**< the 32 bit limbs of the integer */
+} ExactCount;
+
+
+/**
+ * @brief The taps of h for the reduced precision passes
+ */
+typedef struct ReducedTaps
+{
+    float *taps; /**< the reversed taps of h in float */
+    double *wideTaps; /**< the same taps widened back to double for PRECISION_MIXED, or NULL */
+} ReducedTaps;
+
+
+/**
+ * @brief The share of the output indices that one thread computes in every pass
+ */
+typedef struct PassWorker
+{
+    const Experiment *experiment; /**< the experiment shared by all the threads */
+    double **buffers; /**< the 2 buffers that the passes read from and write to in turns */
+    float **reducedBuffers; /**< the 2 float buffers of the reduced precision passes, or NULL */
+    const ReducedTaps *taps; /**< the taps of h for the reduced precision passes */
+    pthread_barrier_t *barrier; /**< the barrier that separates the passes */
+    pthread_mutex_t *startLock; /**< held until the barrier is ready for the threads that started */
+    double *changes; /**< the change of every thread in the last 2 passes, by pass parity */
+    int index; /**< the index of this thread */
+    int count; /**< the number of threads */
+    int passesRun; /**< the number of passes that were applied */
+    int first; /**< the first output index of this thread */
+    int last; /**< the output index after the last one of this thread */
+} PassWorker;
+
+
+/**
+ * @brief A growable buffer that the output is built in before it is written at once
+ */
+typedef struct OutputBuffer
+{
+    char *data; /**< the bytes of the output */
+    size_t size; /**< the number of bytes in the output */
+    size_t capacity; /**< the number of bytes allocated */
+} OutputBuffer;
+
+
+/**
+ * @brief A memory mapped binary input
+ */
+typedef struct MappedInput
+{
+    void *address; /**< the start of the mapping, or NULL if nothing is mapped */
+    size_t length; /**< the number of bytes in the mapping */
+} MappedInput;
+
+
+/**
+ * @brief A kernel of the batch mode, with a plan for every window size its records need
+ */
+typedef struct BatchKernel
+{
+    double *h; /**< the normalized h samples */
+    double scale; /**< the sum that h was divided by when it was normalized */
+    int hSize; /**< the number of samples in h */
+    KernelPlan **plans; /**< the plans of this kernel */
+    int plansCount; /**< the number of plans */
+} BatchKernel;
+
+
+/**
+ * @brief An experiment of the batch mode and its rendered output
+ */
+typedef struct BatchRecord
+{
+    Experiment experiment; /**< the prepared experiment */
+    char *output; /**< the rendered output of the experiment */
+    size_t outputSize; /**< the number of chars in the output */
+    int result; /**< CORRECT_INPUT if the output was rendered, ALLOCATION_ERROR otherwise */
+} BatchRecord;
+
+
+/**
+ * @brief The full linear convolution of a growing g signal with the n-fold convolution of h,
+ * which stays resident between appends
+ */
+typedef struct OnlineConvolution
+{
+    double *kernel; /**< the n-fold convolution of the normalized h */
+    int kernelSize; /**< the number of samples in the kernel */
+    double *result; /**< the convolution of the samples appended so far */
+    long resultSize; /**< the number of samples in the result, |g| + kernelSize - 1 */
+    long capacity; /**< the capacity of the result buffer */
+    long samplesCount; /**< the number of g samples appended so far */
+} OnlineConvolution;
+
+
+/**
+ * @brief The state that the threads of the batch mode share
+ */
+typedef struct BatchWorker
+{
+    BatchRecord *records; /**< the records of the batch */
+    int recordsCount; /**< the number of records */
+    int nextRecord; /**< the next record that no thread took yet */
+    pthread_mutex_t lock; /**< guards nextRecord */
+} BatchWorker;
+
+
+
+
+/**
+ * @brief the engine used to apply the convolutions
+ */
+int engine = ENGINE_AUTO;
+
+/**
+ * @brief the names of the engines, indexed by engine
+ */
+const char *engineNames[NUMBER_OF_ENGINES] = {"direct", "fft", "simd", "auto", "power", "exact", "sparse"};
+
+/**
+ * @brief the primes of the exact engine, each of the form c * 2^k + 1 for a large k
+ */
+const uint64_t nttPrimes[NTT_PRIMES_COUNT] = {998244353, 167772161, 469762049, 754974721, 1004535809};
+
+/**
+ * @brief a primitive root modulo each of the primes of the exact engine
+ */
+const uint64_t nttRoots[NTT_PRIMES_COUNT] = {3, 3, 3, 11, 3};
+
+/**
+ * @brief the way the result is written
+ */
+int output = OUTPUT_HISTOGRAM;
+
+/**
+ * @brief the names of the outputs, indexed by their defines
+ */
+const char *outputNames[NUMBER_OF_OUTPUTS] = {"histogram", "csv", "binned"};
+
+/**
+ * @brief the number of bins of the binned output
+ */
+int binsCount = DEFAULT_BINS_COUNT;
+
+/**
+ * @brief the path of the input file, or NULL to read the input from stdin
+ */
+char *inputPath = NULL;
+
+/**
+ * @brief the mode of the run
+ */
+int mode = MODE_SINGLE;
+
+/**
+ * @brief 1 if the input is a memory mapped binary file, 0 if it is text
+ */
+int binaryInput = 0;
+
+/**
+ * @brief the number of g signals of the channels mode
+ */
+int channelsCount = 1;
+
+/**
+ * @brief the least number of g samples in a streamed block
+ */
+int blockSize = DEFAULT_BLOCK_SIZE;
+
+/**
+ * @brief the number of threads that the vectorized direct engine runs on
+ */
+int threadCount = 1;
+
+/**
+ * @brief the passes stop once no output changes by this much in a pass, 0 applies all n passes
+ */
+double tolerance = 0;
+
+/**
+ * @brief the precision of the direct passes
+ */
+int precision = PRECISION_DOUBLE;
+
+/**
+ * @brief the names of the precisions, indexed by their defines
+ */
+const char *precisionNames[NUMBER_OF_PRECISIONS] = {"double", "single", "mixed"};
+
+/**
+ * @brief 1 if the largest deviation of a reduced precision result from the double passes is
+ * reported on stderr, 0 otherwise
+ */
+int deviationCheck = 0;
+
+/**
+ * @brief 1 if the full linear convolution is written, 0 if only the window is
+ */
+int fullOutput = 0;
+
+/**
+ * @brief 1 if the stats of the run are reported on stderr, 0 otherwise
+ */
+int statsEnabled = 0;
+
+/**
+ * @brief the stats of the run
+ */
+Stats stats;
+
+/**
+ * @brief the names of the phases in the stats, indexed by their defines
+ */
+const char *phaseNames[NUMBER_OF_PHASES] = {"parse", "prepare", "convolve", "render"};
+
+
+
+
+/**
+ * @brief parses the program arguments
+ * @param argc the number of arguments
+ * @param argv the arguments
+ * @return INPUT_ERROR if the arguments are not valid, CORRECT_INPUT otherwise.
+ */
+int parseArguments(int argc, char *argv[]);
+
+/**
+ * @brief Runs an experiment on a g signal that is read as a whole
+ * @param stream the stream to read the input from
+ * @return EXIT_FAILURE if the experiment failed, SUCCESSFUL_EXIT_CODE otherwise.
+ */
+int runExperiment(FILE *stream);
+
+/**
+ * @brief Runs an experiment on a g signal that is streamed. The input is the h line, the n line
+ * and then the g samples until the stream ends. g is convolved block by block (overlap-add)
+ * with the normalized n-fold convolution of h, so memory is bounded by the block size plus the
+ * kernel length. The full linear convolution is printed, one value per line, as soon as each
+ * value is final; g is not normalized since its sum is known only at the end of the stream.
+ * A block is at least as long as the kernel, and fills the transform that the kernel needs.
+ * @param stream the stream to read the input from
+ * @return EXIT_FAILURE if the experiment failed, SUCCESSFUL_EXIT_CODE otherwise.
+ */
+int runStreamExperiment(FILE *stream);
+
+/**
+ * @brief Runs an experiment on a g signal that grows. The input is the h line, the n line and then
+ * lines of g samples. Every line is appended to a resident result, and the values it updated are
+ * printed as "index,value" rows followed by an empty line. Only the last kernel length - 1 values
+ * can still change with the next lines.
+ * @param stream the stream to read the input from
+ * @return EXIT_FAILURE if the experiment failed, SUCCESSFUL_EXIT_CODE otherwise.
+ */
+int runOnlineExperiment(FILE *stream);
+
+/**
+ * @brief Creates an online convolution with the n-fold convolution of a kernel
+ * @param online the online convolution to create
+ * @param h the normalized kernel
+ * @param hSize the number of samples in the kernel
+ * @param n the number of convolutions
+ * @return INPUT_ERROR if the n-fold kernel is too long, ALLOCATION_ERROR if it could not be
+ * allocated, CORRECT_INPUT otherwise.
+ */
+int createOnlineConvolution(OnlineConvolution *online, double *h, int hSize, int n);
+
+/**
+ * @brief Appends g samples and updates the result values they meet, which costs the number of
+ * samples times the kernel length (|h| for a single pass).
+ * @param online the online convolution
+ * @param samples the samples to append
+ * @param count the number of samples
+ * @param firstUpdated will hold the index of the first updated value, the rest up to the end of the
+ * result are updated too
+ * @return ALLOCATION_ERROR if the result could not grow, CORRECT_INPUT otherwise.
+ */
+int appendOnlineSamples(OnlineConvolution *online, const double *samples, int count, long *firstUpdated);
+
+/**
+ * @brief Frees the buffers of an online convolution
+ * @param online the online convolution
+ */
+void freeOnlineConvolution(OnlineConvolution *online);
+
+/**
+ * @brief Runs many experiments that share kernels. Every line of the input is either
+ * "h <samples>", which normalizes a new kernel, or "g <n> <samples>", a record that is convolved n
+ * times with the last kernel. A kernel is centered and prepared once for every window size its
+ * records need. Records are read in batches that are processed by threadCount threads, and their
+ * histograms are printed in input order.
+ * @param stream the stream to read the input from
+ * @return EXIT_FAILURE if a line is not valid or the memory ran out, SUCCESSFUL_EXIT_CODE otherwise.
+ */
+int runBatchExperiments(FILE *stream);
+
+/**
+ * @brief Parses a batch line into a new kernel or a new record
+ * @param line the line to parse
+ * @param kernels the kernels read so far, a new kernel is appended to them
+ * @param kernelsCount the number of kernels
+ * @param kernelsCapacity the capacity of the kernels array
+ * @param records the records of the current batch, a new record is appended to them
+ * @param recordsCount the number of records in the current batch
+ * @return INPUT_ERROR if the line is not valid, ALLOCATION_ERROR if the memory ran out,
+ * CORRECT_INPUT otherwise.
+ */
+int parseBatchLine(char *line, BatchKernel ***kernels, int *kernelsCount, int *kernelsCapacity,
+                   BatchRecord *records, int *recordsCount);
+
+/**
+ * @brief Parses the samples that remain in the line that strtok is currently splitting
+ * @param samples will point to the allocated samples
+ * @param size will hold the number of samples
+ * @return INPUT_ERROR if a sample is not valid, ALLOCATION_ERROR if the memory ran out,
+ * CORRECT_INPUT otherwise.
+ */
+int parseRemainingSamples(double **samples, int *size);
+
+/**
+ * @brief Returns the plan of a batch kernel for a window size, preparing it on first use
+ * @param kernel the batch kernel
+ * @param windowSize the number of samples in the window
+ * @return the plan, or NULL if the memory ran out.
+ */
+KernelPlan *batchKernelPlan(BatchKernel *kernel, int windowSize);
+
+/**
+ * @brief Renders the records of a batch on threadCount threads and prints them in input order
+ * @param records the records
+ * @param recordsCount the number of records
+ * @return ALLOCATION_ERROR if a record could not be rendered, CORRECT_INPUT otherwise.
+ */
+int processBatch(BatchRecord *records, int recordsCount);
+
+/**
+ * @brief Renders the records of a batch that no thread took yet, one at a time
+ * @param argument the shared BatchWorker
+ * @return NULL
+ */
+void *batchWorker(void *argument);
+
+/**
+ * @brief Frees the batch kernels and their plans
+ * @param kernels the kernels
+ * @param kernelsCount the number of kernels
+ */
+void freeBatchKernels(BatchKernel **kernels, int kernelsCount);
+
+/**
+ * @brief Runs one experiment on channelsCount g signals of the same length against one h. The
+ * input is a g line for every channel, the h line and the n line. The channels are interleaved,
+ * so every pass loads each tap of h once and applies it to all the channels. The passes are the
+ * direct ones whatever engine is selected. The output of every channel is written in channel
+ * order, as in the single mode.
+ * @param stream the stream to read the input from
+ * @return EXIT_FAILURE if the experiment failed, SUCCESSFUL_EXIT_CODE otherwise.
+ */
+int runChannelsExperiment(FILE *stream);
+
+/**
+ * @brief Parses the input of the channels mode
+ * @param stream the stream to read from
+ * @param channels will hold the g samples of every channel, and n
+ * @param hSamples will hold the h samples
+ * @param hSize will hold the number of h samples
+ * @return INPUT_ERROR if the input is not valid or the channels differ in length, ALLOCATION_ERROR if
+ * the samples could not be stored, CORRECT_INPUT otherwise.
+ */
+int parseChannels(FILE *stream, Experiment *channels, double **hSamples, int *hSize);
+
+/**
+ * @brief Applies the convolution n times to interleaved channels, like simdConvolutions does to one
+ * @param kernel the kernel
+ * @param signals the windows of the channels, sample k of channel c at k * channels + c
+ * @param channels the number of channels
+ * @param n the number of convolutions
+ * @param resultArray will hold the interleaved results
+ * @param iterationsRun will hold the number of passes that were applied
+ * @return ALLOCATION_ERROR if the intermediate buffer could not be allocated, CORRECT_INPUT otherwise.
+ */
+int channelConvolutions(const KernelPlan *kernel, const double *signals, int channels, int n,
+                        double *resultArray, int *iterationsRun);
+
+/**
+ * @brief Adds an array multiplied by a weight to another array (axpy), VECTOR_LANES samples at a
+ * time when AVX2 is available. The channels mode adds a tap times every channel, and the online
+ * mode adds the kernel times a new sample.
+ * @param out the array that is added to
+ * @param in the array that is multiplied
+ * @param weight the weight
+ * @param length the number of samples in both arrays
+ */
+void addScaled(double *out, const double *in, double weight, int length);
+
+#ifdef AVX2_DISPATCH
+/**
+ * @brief The AVX2 loop of addScaled
+ * @param out the array that is added to
+ * @param in the array that is multiplied
+ * @param weight the weight
+ * @param length the number of samples in both arrays
+ * @return the number of samples added, a multiple of VECTOR_LANES
+ */
+int avx2AddScaled(double *out, const double *in, double weight, int length);
+#endif
+
+/**
+ * @brief Computes the n-fold convolution of a kernel with itself in the frequency domain
+ * @param kernel the kernel
+ * @param kernelSize the number of samples in the kernel
+ * @param iterations the number of convolutions
+ * @param powerSize will hold the number of samples in the result
+ * @return the allocated n-fold kernel, or NULL if the allocation failed.
+ */
+double *kernelPower(double *kernel, int kernelSize, int iterations, long *powerSize);
+
+/**
+ * @brief Applies the convolutions of an experiment and prints the histogram of the result
+ * @param experiment the prepared experiment
+ * @param out the stream to print to
+ * @param threads the number of threads the engine may run on
+ * @return ALLOCATION_ERROR if the engine could not allocate its buffers, INPUT_ERROR if the engine
+ * cannot convolve the input, CORRECT_INPUT otherwise.
+ */
+int renderExperiment(Experiment *experiment, FILE *out, int threads);
+
+/**
+ * @brief Applies the convolutions of an experiment to g without the window and prints the whole
+ * result, of |g| + n(|h| - 1) samples
+ * @param experiment the prepared experiment
+ * @param out the stream to print to
+ * @return INPUT_ERROR if the result is too long, ALLOCATION_ERROR if it could not be allocated,
+ * CORRECT_INPUT otherwise.
+ */
+int renderFullExperiment(Experiment *experiment, FILE *out);
+
+/**
+ * @brief Adds the multiply-adds an engine performed to the stats of the experiment, if it has any
+ * @param experiment the experiment
+ * @param count the number of multiply-adds
+ */
+void countMultiplyAdds(Experiment *experiment, long long count);
+
+/**
+ * @brief Prints the stats as a single JSON line on stderr
+ * @param stats the stats
+ * @param iterations the number of passes that were applied
+ */
+void printStats(const Stats *stats, int iterations);
+
+/**
+ * @brief Reads a character of the input, counting it in the stats when they are reported
+ * @param stream the stream to read from
+ * @return the character, or EOF
+ */
+int readByte(FILE *stream);
+
+/**
+ * @brief Pushes a character back to the input, uncounting it in the stats when they are reported
+ * @param c the character
+ * @param stream the stream it was read from
+ */
+void unreadByte(int c, FILE *stream);
+
+/**
+ * @brief parses the users input
+ * @param stream the stream to read the input from
+ * @param experiment will hold the g samples and n
+ * @param hSamples will point to the h samples
+ * @param hSize will hold the number of h samples
+ * @return INPUT_ERROR if the parsing was unsuccessful, ALLOCATION_ERROR if the samples could not
+ * be stored, CORRECT_INPUT otherwise.
+ */
+int parseInput(FILE *stream, Experiment *experiment, double **hSamples, int *hSize);
+
+/**
+ * @brief Memory maps a binary input and uses its samples as the g and h buffers, without copying.
+ * The mapping is private, so normalizing the samples in place never writes to the file.
+ * A g shorter than the window is copied, since it is centered in a larger buffer.
+ * @param stream the stream of the binary input, must be a regular file
+ * @param experiment will hold the g samples and n
+ * @param hSamples will point to the h samples
+ * @param hSize will hold the number of h samples
+ * @param mapping will hold the mapping
+ * @return INPUT_ERROR if the input is not a valid binary input, ALLOCATION_ERROR if it could not be
+ * mapped, CORRECT_INPUT otherwise.
+ */
+int mapInput(FILE *stream, Experiment *experiment, double **hSamples, int *hSize, MappedInput *mapping);
+
+/**
+ * @brief Decodes a little endian 64 bit integer
+ * @param bytes the encoded integer
+ * @return the integer
+ */
+uint64_t decodeLittleEndian(const unsigned char *bytes);
+
+/**
+ * @brief Converts mapped little endian samples to the byte order of the machine, and validates them
+ * @param samples the samples
+ * @param size the number of samples
+ * @return INPUT_ERROR if a sample is negative or not finite, CORRECT_INPUT otherwise.
+ */
+int decodeSamples(double *samples, long size);
+
+/**
+ * @brief Frees a samples buffer, unless it is a part of the mapping
+ * @param samples the samples buffer
+ * @param mapping the mapping
+ */
+void releaseSamples(double *samples, const MappedInput *mapping);
+
+/**
+ * @brief Reads the number of iterations line from the given stream
+ * @param stream the stream to read from
+ * @param iterations will hold the number of iterations
+ * @return INPUT_ERROR if the line is missing or not valid, CORRECT_INPUT otherwise.
+ */
+int readIterations(FILE *stream, int *iterations);
+
+/**
+ * @brief Parses the number of iterations
+ * @param text the text to parse
+ * @param iterations will hold the number of iterations
+ * @return INPUT_ERROR if the text is not a valid number of iterations, CORRECT_INPUT otherwise.
+ */
+int parseIterations(char *text, int *iterations);
+
+/**
+ * @brief Reads the next sample from the given stream
+ * @param stream the stream to read from
+ * @param sample will hold the sample
+ * @param stopAtLineBreak 1 if the samples end at a line break, 0 if they end with the stream only
+ * @return END_OF_SAMPLES if there are no more samples, INPUT_ERROR if the sample is not valid,
+ * CORRECT_INPUT otherwise.
+ */
+int readNextSample(FILE *stream, double *sample, int stopAtLineBreak);
+
+/**
+ * @brief Reads a line of samples from the given stream straight into a growable heap buffer.
+ * @param stream the stream to read from
+ * @param samples will point to the allocated samples buffer
+ * @param size will hold the number of samples that were read
+ * @return INPUT_ERROR if the stream ended before the line or a sample is not valid,
+ * ALLOCATION_ERROR if the buffer could not grow, CORRECT_INPUT otherwise.
+ */
+int readSamples(FILE *stream, double **samples, int *size);
+
+/**
+ * @brief Appends a sample to a growable buffer, doubling its capacity when it is full
+ * @param samples the buffer
+ * @param size the number of samples in the buffer
+ * @param capacity the capacity of the buffer
+ * @param sample the sample to append
+ * @return ALLOCATION_ERROR if the buffer could not grow, CORRECT_INPUT otherwise.
+ */
+int appendSample(double **samples, int *size, int *capacity, double sample);
+
+/**
+ * @brief Reads a line of any length from the given stream, without the line break.
+ * @param stream the stream to read from
+ * @return the allocated line, or NULL if the stream ended or the allocation failed.
+ */
+char *readLine(FILE *stream);
+
+/**
+ * @brief Resizes the samples buffer to the window size and zeroes the samples after the input
+ * @param array the samples buffer
+ * @param arraySize the number of samples in the buffer
+ * @param windowSize the number of samples in the window
+ * @return ALLOCATION_ERROR if the buffer could not be resized, CORRECT_INPUT otherwise.
+ */
+int fitToWindow(double **array, int arraySize, int windowSize);
+
+/**
+ * @brief Writes the window in the selected output
+ * @param out the stream to write to
+ * @param array the window, may be rounded in place
+ * @param arraySize the array size
+ * @return ALLOCATION_ERROR if the output could not be built, CORRECT_INPUT otherwise.
+ */
+int renderValues(FILE *out, double array[], int arraySize);
+
+/**
+ * @brief Prints the histogram. The rows are built in one buffer that is written at once.
+ * @param out the stream to print to
+ * @param array The histogram will be printed according to this array
+ * @param arraySize the array size
+ * @return ALLOCATION_ERROR if the output could not be built, CORRECT_INPUT otherwise.
+ */
+int histogram(FILE *out, double array[], int arraySize);
+
+/**
+ * @brief Prints the histogram of the array summed into consecutive bins of (nearly) equal width,
+ * each row labeled by the range of indices of its bin.
+ * @param out the stream to print to
+ * @param array the array to bin
+ * @param arraySize the array size
+ * @param bins the number of bins, at most arraySize of them are used
+ * @return ALLOCATION_ERROR if the output could not be built, CORRECT_INPUT otherwise.
+ */
+int binnedHistogram(FILE *out, const double array[], int arraySize, int bins);
+
+/**
+ * @brief Writes the unrounded values of the array as CSV rows of index and value
+ * @param out the stream to write to
+ * @param array the array to write
+ * @param arraySize the array size
+ * @return ALLOCATION_ERROR if the output could not be built, CORRECT_INPUT otherwise.
+ */
+int writeValues(FILE *out, const double array[], int arraySize);
+
+/**
+ * @brief Appends a histogram row: the label, the value, and asterisks relative to the maximum
+ * @param buffer the output buffer, must have OUTPUT_ROW_CAPACITY bytes reserved
+ * @param label the label of the row
+ * @param value the value of the row
+ * @param max the maximal value of the histogram
+ */
+void appendHistogramRow(OutputBuffer *buffer, const char *label, double value, double max);
+
+/**
+ * @brief Makes sure the output buffer has room for more bytes, growing it geometrically
+ * @param buffer the output buffer
+ * @param length the number of bytes to make room for
+ * @return ALLOCATION_ERROR if the buffer could not be grown, CORRECT_INPUT otherwise.
+ */
+int reserveOutput(OutputBuffer *buffer, size_t length);
+
+/**
+ * @brief Writes the output buffer in one write and frees it
+ * @param out the stream to write to
+ * @param buffer the output buffer
+ */
+void flushOutput(FILE *out, OutputBuffer *buffer);
+
+/**
+ * @brief Returns the index of the maximum value in a given array
+ * @param array The array to search
+ * @param arraySize the array size
+ */
+int indexOfMaxValue(double *array, int arraySize);
+
+/**
+ * @brief Rounds the elements of the array to 3 digits after the decimal point
+ * @param array The array to round
+ * @param arraySize The size of the array
+ */
+void roundBeforeHistogram(double *array, int arraySize);
+
+/**
+ * @brief parameterization of the convolution bounds with respect to t.
+ * @param t The index in the convolution
+ * @param size The size of the array
+ * @return The actual index after the parameterization.
+ */
+int parameterization(int t, int size);
+
+/**
+ * @brief Applies the convolution n times with the engine that was selected
+ * @param experiment the experiment
+ * @param resultArray the array that will contain the result of the convolution
+ * @param threads the number of threads the engine may run on
+ * @return ALLOCATION_ERROR if the engine could not allocate its buffers, INPUT_ERROR if the engine
+ * cannot convolve the input, CORRECT_INPUT otherwise.
+ */
+int applyConvolutions(Experiment *experiment, double *resultArray, int threads);
+
+/**
+ * @brief Splits the output indices of the passes across the workers, and runs the share of the
+ * workers that could not be started on the calling thread
+ * @param experiment the experiment
+ * @param buffers the 2 double buffers of the passes, the first one holding g, or NULL
+ * @param reducedBuffers the 2 float buffers of the reduced precision passes, or NULL
+ * @param taps the taps of h when reducedBuffers is set
+ * @param threads the number of threads
+ * @return the number of passes that were applied, or ALLOCATION_ERROR if the workers could not be allocated.
+ */
+int runPassWorkers(const Experiment *experiment, double **buffers, float **reducedBuffers,
+                   const ReducedTaps *taps, int threads);
+
+/**
+ * @brief Applies the convolution n times like simdConvolutions, with g, h and the passes stored
+ * in float, so a load holds twice the samples and the passes move half the memory. The products
+ * are summed in float for PRECISION_SINGLE and in two registers of double for PRECISION_MIXED.
+ * @param experiment the experiment
+ * @param resultArray the array that will contain the result of the convolution
+ * @param threads the number of threads, which split the output indices like threadedConvolutions
+ * @return ALLOCATION_ERROR if the intermediate buffers could not be allocated, CORRECT_INPUT otherwise.
+ */
+int reducedConvolutions(Experiment *experiment, double *resultArray, int threads);
+
+/**
+ * @brief Computes one output index of a reduced precision pass, over the same g indices as
+ * directConvolutionAt
+ * @param source the float samples the pass is applied to
+ * @param taps the taps of h
+ * @param kernel the kernel of the pass
+ * @param j the output index
+ * @return the value of the output index
+ */
+float reducedConvolutionAt(const float *source, const ReducedTaps *taps, const KernelPlan *kernel, int j);
+
+/**
+ * @brief Returns the dot product of two float arrays, summed in float
+ * @param x the first array
+ * @param y the second array
+ * @param length the number of samples in both arrays
+ */
+float singleDotProduct(const float *x, const float *y, int length);
+
+/**
+ * @brief Returns the dot product of a float array and the taps of h widened from float to double,
+ * summed in double with SINGLE_PRODUCT_LANES partial sums
+ * @param x the float array
+ * @param y the widened taps, whose values are floats
+ * @param length the number of samples in both arrays
+ */
+double mixedDotProduct(const float *x, const double *y, int length);
+
+#ifdef AVX2_DISPATCH
+/**
+ * @brief The AVX2 loop of singleDotProduct, which sums into SINGLE_PRODUCT_LANES partial sums
+ * @param x the first array
+ * @param y the second array
+ * @param length the number of samples in both arrays
+ * @param partialSums the partial sums, SINGLE_PRODUCT_LANES of them
+ * @return the number of samples summed, a multiple of SINGLE_PRODUCT_LANES
+ */
+int avx2SingleDotProductLanes(const float *x, const float *y, int length, float *partialSums);
+
+/**
+ * @brief The AVX2 loop of mixedDotProduct, which loads SINGLE_PRODUCT_LANES floats at a time and
+ * sums their halves in two registers of double
+ * @param x the float array
+ * @param y the widened taps
+ * @param length the number of samples in both arrays
+ * @param partialSums the partial sums, SINGLE_PRODUCT_LANES of them
+ * @return the number of samples summed, a multiple of SINGLE_PRODUCT_LANES
+ */
+int avx2MixedDotProductLanes(const float *x, const double *y, int length, double *partialSums);
+#endif
+
+/**
+ * @brief Applies the passes of the reduced precision result in double and prints the largest
+ * deviation of the result from them on stderr
+ * @param experiment the experiment
+ * @param resultArray the result of reducedConvolutions
+ * @param threads the number of threads the double passes may run on
+ * @return ALLOCATION_ERROR if the double passes could not allocate their buffers, CORRECT_INPUT otherwise.
+ */
+int reportDeviation(Experiment *experiment, const double *resultArray, int threads);
+
+/**
+ * @brief Runs the double or reduced precision passes over the output indices of one thread
+ * @param argument the PassWorker of the thread
+ * @return NULL
+ */
+void *passWorker(void *argument);
+
+/**
+ * @brief Checks whether the passes converged, according to the tolerance
+ * @param current the output of the last pass
+ * @param previous the input of the last pass
+ * @param arraySize the size of each array
+ * @return 1 if a tolerance is set and no output changed by that much, 0 otherwise.
+ */
+int hasConverged(const double *current, const double *previous, int arraySize);
+
+/**
+ * @brief Centers a normalized h in the window and prepares it for the direct engines, including
+ * the list of its non zero samples for the sparse engine
+ * @param kernel the kernel to prepare
+ * @param hSamples the normalized h samples
+ * @param hSize the number of h samples
+ * @param windowSize the number of samples in the window
+ * @return ALLOCATION_ERROR if the kernel could not be allocated, CORRECT_INPUT otherwise.
+ */
+int createKernelPlan(KernelPlan *kernel, const double *hSamples, int hSize, int windowSize);
+
+/**
+ * @brief Computes one output index of a pass of the vectorized direct engine, with convolutionAt
+ * of libconv
+ * @param source the samples the pass is applied to
+ * @param kernel the prepared kernel
+ * @param j the output index
+ * @return the convolution at the output index
+ */
+double directConvolutionAt(const double *source, const KernelPlan *kernel, int j);
+
+/**
+ * @brief Applies the convolution n times by binary exponentiation. A pass of nConvolutions is the
+ * linear map g -> window(g * h), so it is written as a windowSize x windowSize matrix, squared
+ * O(log n) times and applied to g once for every set bit of n. Every entry is an exact direct
+ * sum, and unlike the fft engine the window still truncates every pass, so the result is the one
+ * of nConvolutions. Costs O(windowSize^3 log n) instead of O(n windowSize hSize).
+ * @param experiment the experiment
+ * @param resultArray the array that will contain the result of the convolution
+ * @return ALLOCATION_ERROR if the matrices could not be allocated, CORRECT_INPUT otherwise.
+ */
+int powerConvolutions(Experiment *experiment, double *resultArray);
+
+/**
+ * @brief Multiplies two square matrices that are stored row by row
+ * @param left the left matrix
+ * @param right the right matrix
+ * @param product the matrix that will contain the product, must not be one of the factors
+ * @param size the number of rows of each matrix
+ */
+void multiplyMatrices(const double *left, const double *right, double *product, int size);
+
+/**
+ * @brief Multiplies a square matrix that is stored row by row by a vector
+ * @param matrix the matrix
+ * @param vector the vector
+ * @param product the vector that will contain the product, must not be the factor
+ * @param size the number of rows of the matrix
+ */
+void multiplyMatrixByVector(const double *matrix, const double *vector, double *product, int size);
+
+/**
+ * @brief Applies the convolution n times to g without the window, so no mass is dropped. The
+ * result holds |g| + n(|h| - 1) samples. The fft engine transforms once, at a size chosen for the
+ * final length; the other engines apply the passes directly, in two buffers that grow
+ * geometrically as the signal widens.
+ * @param experiment the experiment
+ * @param resultArray will point to the allocated result
+ * @param resultSize will hold the number of samples in the result
+ * @return INPUT_ERROR if the result is too long, ALLOCATION_ERROR if the buffers could not be
+ * allocated, CORRECT_INPUT otherwise.
+ */
+int fullConvolutions(Experiment *experiment, double **resultArray, int *resultSize);
+
+/**
+ * @brief Computes the full n-fold convolution of g and h in the frequency domain
+ * @param experiment the experiment
+ * @param resultArray the array that will contain the result of the convolution
+ * @param resultSize the number of samples in the result
+ * @return ALLOCATION_ERROR if the transform buffers could not be allocated, CORRECT_INPUT otherwise.
+ */
+int fullFftConvolutions(Experiment *experiment, double *resultArray, int resultSize);
+
+/**
+ * @brief Grows the buffers of fullConvolutions to hold a number of samples, doubling their capacity
+ * @param current the buffer of the current pass
+ * @param next the buffer of the next pass
+ * @param capacity the capacity of both buffers
+ * @param size the number of samples the buffers must hold
+ * @return ALLOCATION_ERROR if the buffers could not grow, CORRECT_INPUT otherwise.
+ */
+int growPassBuffers(double **current, double **next, int *capacity, int size);
+
+/**
+ * @brief Applies an in place iterative radix 2 fast fourier transform
+ * @param data the samples to transform
+ * @param size the number of samples, must be a power of 2
+ * @param inverse 1 for the inverse transform (including the 1/size scaling), 0 otherwise
+ */
+void fft(double complex *data, long size, int inverse);
+
+/**
+ * @brief Raises a complex number to a non negative integer power by repeated squaring
+ * @param base the number to raise
+ * @param exponent the power
+ * @return base raised to the power of exponent
+ */
+double complex complexPower(double complex base, int exponent);
+
+/**
+ * @brief Transforms h, placed where fftConvolutions expects it, and raises the transform to the
+ * n-th power pointwise
+ * @param kernel the kernel
+ * @param transformSize the number of samples in the transform
+ * @param n the power
+ * @param spectrum the zeroed transform buffer, which will hold the result
+ */
+void transformKernel(const KernelPlan *kernel, long transformSize, int n, double complex *spectrum);
+
+/**
+ * @brief Returns the spectrum of a kernel cached for a transform size and a power
+ * @param kernel the kernel
+ * @param transformSize the number of samples in the transform
+ * @param n the power
+ * @return the spectrum, or NULL if it was not cached.
+ */
+const double complex *findKernelSpectrum(const KernelPlan *kernel, long transformSize, int n);
+
+/**
+ * @brief Caches the spectrum that fftConvolutions multiplies g by for n passes, unless the kernel
+ * already holds it, so the records that share the kernel transform h once
+ * @param kernel the kernel
+ * @param n the number of passes
+ * @return ALLOCATION_ERROR if the spectrum could not be allocated, CORRECT_INPUT otherwise.
+ */
+int cacheKernelSpectrum(KernelPlan *kernel, int n);
+
+/**
+ * @brief Returns the smallest power of 2 that is not smaller than the given size
+ * @param size the size to round up
+ */
+long nextPowerOfTwo(long size);
+
+/**
+ * @brief Applies the convolution n times exactly, for g and h that are integer counts. The counts
+ * are restored from the normalized samples, convolved with number theoretic transforms modulo
+ * as many primes as the largest possible output needs, and reconstructed with the chinese
+ * remainder theorem (Garner) in multiword integers. The exact counts are normalized only at the
+ * end, so every value is its count divided by sum(g) * sum(h)^n, rounded once. Like the fft
+ * engine, the window is applied to the final result only.
+ * @param experiment the experiment
+ * @param resultArray the array that will contain the result of the convolution
+ * @return INPUT_ERROR if g or h are not integer counts or sum(g) * sum(h)^n does not fit in the
+ * product of the primes, ALLOCATION_ERROR if the buffers could not be allocated, CORRECT_INPUT otherwise.
+ */
+int exactConvolutions(Experiment *experiment, double *resultArray);
+
+/**
+ * @brief Convolves the counts n times modulo a prime with a number theoretic transform
+ * @param gCounts the g counts, in the window
+ * @param hCounts the h counts
+ * @param experiment the experiment
+ * @param transformSize the size of the transform, must divide prime - 1
+ * @param prime the index of the prime in nttPrimes
+ * @param residues will hold the residues of the window of the result
+ * @return ALLOCATION_ERROR if the transform buffers could not be allocated, CORRECT_INPUT otherwise.
+ */
+int residueConvolutions(const uint64_t *gCounts, const uint64_t *hCounts, const Experiment *experiment,
+                        long transformSize, int prime, uint64_t *residues);
+
+/**
+ * @brief Restores the integer counts of normalized samples
+ * @param samples the normalized samples
+ * @param size the number of samples
+ * @param scale the sum that the samples were divided by
+ * @param counts will hold the counts
+ * @param sum will hold the sum of the counts
+ * @return INPUT_ERROR if a sample is not an integer count, CORRECT_INPUT otherwise.
+ */
+int restoreCounts(const double *samples, int size, double scale, uint64_t *counts, double *sum);
+
+/**
+ * @brief Applies an in place iterative radix 2 number theoretic transform
+ * @param data the residues to transform
+ * @param size the number of residues, a power of 2 that divides prime - 1
+ * @param inverse 1 for the inverse transform (including the 1/size scaling), 0 otherwise
+ * @param prime the modulus
+ * @param root a primitive root modulo the prime
+ */
+void ntt(uint64_t *data, long size, int inverse, uint64_t prime, uint64_t root);
+
+/**
+ * @brief Raises a residue to a non negative integer power by repeated squaring
+ * @param base the residue to raise, smaller than the modulus
+ * @param exponent the power
+ * @param modulus the modulus, smaller than 2^32
+ * @return base raised to the power of exponent, modulo the modulus
+ */
+uint64_t modularPower(uint64_t base, uint64_t exponent, uint64_t modulus);
+
+/**
+ * @brief Sets an exact count to an integer
+ * @param count the exact count
+ * @param value the integer
+ */
+void setExactCount(ExactCount *count, uint64_t value);
+
+/**
+ * @brief Multiplies an exact count by a factor and adds an addend, which is how the Garner digits
+ * are accumulated
+ * @param count the exact count, which will hold the result
+ * @param factor the factor
+ * @param addend the addend
+ */
+void multiplyAddExactCount(ExactCount *count, uint32_t factor, uint32_t addend);
+
+/**
+ * @brief Multiplies two exact counts, whose product must fit in EXACT_COUNT_LIMBS limbs
+ * @param x the first count
+ * @param y the second count
+ * @param product will hold the product, may not be x or y
+ */
+void multiplyExactCounts(const ExactCount *x, const ExactCount *y, ExactCount *product);
+
+/**
+ * @brief Adds an exact count to another one
+ * @param sum the count that is added to
+ * @param addend the count to add
+ */
+void addExactCounts(ExactCount *sum, const ExactCount *addend);
+
+/**
+ * @brief Subtracts an exact count from a count that is not smaller
+ * @param difference the count that is subtracted from
+ * @param subtrahend the count to subtract
+ */
+void subtractExactCounts(ExactCount *difference, const ExactCount *subtrahend);
+
+/**
+ * @brief Compares two exact counts
+ * @param x the first count
+ * @param y the second count
+ * @return a negative value if x < y, 0 if they are equal, a positive value otherwise.
+ */
+int compareExactCounts(const ExactCount *x, const ExactCount *y);
+
+/**
+ * @brief Returns the quotient of two exact counts, rounded to the nearest double
+ * @param numerator the numerator, not larger than the denominator
+ * @param denominator the denominator, positive
+ * @return the correctly rounded quotient, in [0, 1].
+ */
+double divideExactCounts(const ExactCount *numerator, const ExactCount *denominator);
+
+/**
+ * @brief Applies a convolution
+ * @param kernel The kernel to convolve with
+ * @param array The samples to convolve
+ * @param t The index for the convolution
+ * @return The result of the convolution
+ */
+double singleConvolution(const KernelPlan *kernel, double array[], int t);
+
+/**
+ * @brief checks the validity of parameterized bounds
+ * @param t The parameterized index for the convultion
+ * @param m The actual index after the parameterization.
+ * @param windowSize the number of samples in the window
+ * @return 1 if the bounds are valid or false otherwise.
+ */
+int checkBoundsForSingleConvolution(int t, int m, int windowSize);
+
+/**
+ * @brief Normalizes g and centers it in the window of the given kernel
+ * @param experiment the experiment, holding the parsed g samples
+ * @param kernel the prepared kernel
+ * @return ALLOCATION_ERROR if g could not be resized to the window, CORRECT_INPUT otherwise.
+ */
+int prepareSignal(Experiment *experiment, const KernelPlan *kernel);
+
+/**
+ * @brief Centers the given array
+ * @param array the array to center
+ * @param arraySize the size of the array
+ * @param windowSize the number of samples in the window
+ */
+void centerArray(double array[], int arraySize, int windowSize);
+
+/**
+ * @brief Find the location of the decimal point.
+ * @param charArray charArray that represents a double number
+ * @return The location of the decimal point. If there is no decimal point this function will
+ * returns the length of the "number", and if there is more than 1 decimal point,
+ * this function will return an input error.
+ */
+int findDecimalPointPosition(char *charArray);
+
+
+/**
+ * @brief Converts a char array to a non positive double
+ * @param array The char array to be converted
+ * @return returns the double If the char array represents a valid double, otherwise,
+ * returns input error.
+ */
+double extractDoubleFromString(char *array);
+
+
+
+
+// DrumBenchmark links the engines of this file with a main of its own
+#ifndef DRUM_BENCHMARK
+/**
+ * @brief The main method.
+ */
+int main(int argc, char *argv[])
+{
+    if(parseArguments(argc, argv) == INPUT_ERROR)
+    {
+        fprintf(stderr, USAGE_ERROR);
+        return EXIT_FAILURE;
+    }
+    FILE *inputStream = stdin;
+    if(inputPath != NULL && (inputStream = fopen(inputPath, "r")) == NULL)
+    {
+        fprintf(stderr, "ERROR\n");
+        return EXIT_FAILURE;
+    }
+    int exitCode;
+    switch (mode)
+    {
+        case MODE_STREAM:
+            exitCode = runStreamExperiment(inputStream);
+            break;
+        case MODE_ONLINE:
+            exitCode = runOnlineExperiment(inputStream);
+            break;
+        case MODE_BATCH:
+            exitCode = runBatchExperiments(inputStream);
+            break;
+        case MODE_CHANNELS:
+            exitCode = runChannelsExperiment(inputStream);
+            break;
+        default:
+            exitCode = runExperiment(inputStream);
+    }
+    if(inputStream != stdin)
+    {
+        fclose(inputStream);
+    }
+    return exitCode;
+}
+#endif
+
+
+int runExperiment(FILE *stream)
+{
+    Experiment experiment;
+    KernelPlan kernel;
+    MappedInput mapping;
+    double *hSamples = NULL;
+    int hSize = 0;
+    experiment.g = NULL;
+    experiment.stats = statsEnabled ? &stats : NULL;
+    kernel.h = NULL;
+    kernel.reversedTaps = NULL;
+    kernel.tapShifts = NULL;
+    kernel.tapWeights = NULL;
+    kernel.spectra = NULL;
+    kernel.spectraCount = 0;
+    mapping.address = NULL;
+    PhaseTime start = phaseStart();
+    int result = binaryInput ? mapInput(stream, &experiment, &hSamples, &hSize, &mapping) :
+                 parseInput(stream, &experiment, &hSamples, &hSize);
+    recordPhase(experiment.stats, PHASE_PARSE, start);
+    if (binaryInput && statsEnabled)
+    {
+        stats.bytesRead = mapping.length;
+    }
+    if(result == CORRECT_INPUT)
+    {
+        start = phaseStart();
+        result = prepareInputForConvolution(&experiment, &kernel, hSamples, hSize);
+        recordPhase(experiment.stats, PHASE_PREPARE, start);
+    }
+    releaseSamples(hSamples, &mapping);
+    if (result == CORRECT_INPUT && statsEnabled)
+    {
+        // the output is counted in memory, and its final write is a part of the render phase
+        char *output = NULL;
+        size_t outputSize = 0;
+        FILE *out = open_memstream(&output, &outputSize);
+        result = (out == NULL) ? ALLOCATION_ERROR : renderExperiment(&experiment, out, threadCount);
+        if (out != NULL && fclose(out) != 0)
+        {
+            result = ALLOCATION_ERROR;
+        }
+        if (result == CORRECT_INPUT)
+        {
+            start = phaseStart();
+            fwrite(output, 1, outputSize, stdout);
+            fflush(stdout);
+            recordPhase(experiment.stats, PHASE_RENDER, start);
+            stats.bytesWritten = outputSize;
+        }
+        free(output);
+    }
+    else if (result == CORRECT_INPUT)
+    {
+        result = renderExperiment(&experiment, stdout, threadCount);
+    }
+    if (result == CORRECT_INPUT && tolerance > 0 && experiment.n > MINIMUM_ITERATIONS)
+    {
+        fprintf(stderr, "Iterations: %d\n", experiment.iterationsRun);
+    }
+    if (result == CORRECT_INPUT && statsEnabled)
+    {
+        printStats(&stats, (experiment.n > MINIMUM_ITERATIONS) ? experiment.iterationsRun : 0);
+    }
+    releaseSamples(experiment.g, &mapping);
+    freeKernelPlan(&kernel);
+    if (mapping.address != NULL)
+    {
+        munmap(mapping.address, mapping.length);
+    }
+    if (result != CORRECT_INPUT)
+    {
+        fprintf(stderr, "ERROR\n");
+        return EXIT_FAILURE;
+    }
+    return SUCCESSFUL_EXIT_CODE;
+}
+
+int renderExperiment(Experiment *experiment, FILE *out, int threads)
+{
+    if (fullOutput)
+    {
+        return renderFullExperiment(experiment, out);
+    }
+    int windowSize = (*(*experiment).kernel).windowSize;
+    if((*experiment).n > MINIMUM_ITERATIONS)
+    {
+        double *resultArray = (double*) malloc(sizeof(double) * windowSize);
+        if(resultArray == NULL)
+        {
+            return ALLOCATION_ERROR;
+        }
+        PhaseTime start = phaseStart();
+        int result = applyConvolutions(experiment, resultArray, threads);
+        recordPhase((*experiment).stats, PHASE_CONVOLVE, start);
+        // the double passes of the check are not a part of the timed convolve phase
+        if (result == CORRECT_INPUT && deviationCheck)
+        {
+            result = reportDeviation(experiment, resultArray, threads);
+        }
+        if (result != CORRECT_INPUT)
+        {
+            free(resultArray);
+            return result;
+        }
+        start = phaseStart();
+        result = renderValues(out, resultArray, windowSize);
+        recordPhase((*experiment).stats, PHASE_RENDER, start);
+        free(resultArray);
+        if (result == ALLOCATION_ERROR)
+        {
+            return ALLOCATION_ERROR;
+        }
+    }
+    else
+    {
+        PhaseTime start = phaseStart();
+        int result = renderValues(out, (*experiment).g, windowSize);
+        recordPhase((*experiment).stats, PHASE_RENDER, start);
+        if (result == ALLOCATION_ERROR)
+        {
+            return ALLOCATION_ERROR;
+        }
+    }
+    fprintf(out, "\n");
+    return CORRECT_INPUT;
+}
+
+int renderFullExperiment(Experiment *experiment, FILE *out)
+{
+    int result;
+    (*experiment).iterationsRun = (*experiment).n;
+    if ((*experiment).n > MINIMUM_ITERATIONS)
+    {
+        double *resultArray = NULL;
+        int resultSize = 0;
+        PhaseTime start = phaseStart();
+        result = fullConvolutions(experiment, &resultArray, &resultSize);
+        recordPhase((*experiment).stats, PHASE_CONVOLVE, start);
+        if (result == CORRECT_INPUT)
+        {
+            start = phaseStart();
+            result = renderValues(out, resultArray, resultSize);
+            recordPhase((*experiment).stats, PHASE_RENDER, start);
+        }
+        free(resultArray);
+    }
+    else
+    {
+        PhaseTime start = phaseStart();
+        int gStart = centerStart((*experiment).gSize, (*(*experiment).kernel).windowSize);
+        result = renderValues(out, (*experiment).g + gStart, (*experiment).gSize);
+        recordPhase((*experiment).stats, PHASE_RENDER, start);
+    }
+    if (result == CORRECT_INPUT)
+    {
+        fprintf(out, "\n");
+    }
+    return result;
+}
+
+PhaseTime phaseStart(void)
+{
+    struct timespec wall;
+    struct timespec cpu;
+    clock_gettime(CLOCK_MONOTONIC, &wall);
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu);
+    PhaseTime start = {wall.tv_sec + wall.tv_nsec / 1e9, cpu.tv_sec + cpu.tv_nsec / 1e9};
+    return start;
+}
+
+
+void recordPhase(Stats *stats, int phase, PhaseTime start)
+{
+    if (stats == NULL)
+    {
+        return;
+    }
+    PhaseTime end = phaseStart();
+    (*stats).phases[phase].wall += end.wall - start.wall;
+    (*stats).phases[phase].cpu += end.cpu - start.cpu;
+    return;
+}
+
+
+void countMultiplyAdds(Experiment *experiment, long long count)
+{
+    if ((*experiment).stats != NULL)
+    {
+        (*(*experiment).stats).multiplyAdds += count;
+    }
+    return;
+}
+
+
+long long passMultiplyAdds(const KernelPlan *kernel, int dense)
+{
+    int windowSize = (*kernel).windowSize;
+    long long count = 0;
+    for (int j = 0; j < windowSize; ++j)
+    {
+        // g[k] meets h[j + offset - k]
+        int first = dense ? j + (*kernel).offset - windowSize + 1 : j + (*kernel).offset - (*kernel).high;
+        int last = dense ? j + (*kernel).offset : first + (*kernel).hSize - 1;
+        first = (first > 0) ? first : 0;
+        last = (last < windowSize - 1) ? last : windowSize - 1;
+        count += (last >= first) ? last - first + 1 : 0;
+    }
+    return count;
+}
+
+
+long long transformButterflies(long size)
+{
+    long long butterflies = 0;
+    for (long length = 2; length <= size; length <<= 1)
+    {
+        butterflies += size / 2;
+    }
+    return butterflies;
+}
+
+
+int powerMultiplications(int exponent)
+{
+    int multiplications = 0;
+    while (exponent > 0)
+    {
+        multiplications += 1 + exponent % 2;
+        exponent = exponent / 2;
+    }
+    return multiplications;
+}
+
+
+void printStats(const Stats *stats, int iterations)
+{
+    fprintf(stderr, "{\"engine\":\"%s\",\"iterations\":%d", engineNames[(*stats).engine], iterations);
+    for (int phase = 0; phase < NUMBER_OF_PHASES; ++phase)
+    {
+        fprintf(stderr, ",\"%s\":{\"wall\":%.9f,\"cpu\":%.9f}", phaseNames[phase],
+                (*stats).phases[phase].wall, (*stats).phases[phase].cpu);
+    }
+    fprintf(stderr, ",\"multiplyAdds\":%lld,\"bytesRead\":%lld,\"bytesWritten\":%lld}\n",
+            (*stats).multiplyAdds, (*stats).bytesRead, (*stats).bytesWritten);
+    return;
+}
+
+
+int readByte(FILE *stream)
+{
+    int c = getc(stream);
+    if (statsEnabled && c != EOF)
+    {
+        ++stats.bytesRead;
+    }
+    return c;
+}
+
+
+void unreadByte(int c, FILE *stream)
+{
+    ungetc(c, stream);
+    if (statsEnabled && c != EOF)
+    {
+        --stats.bytesRead;
+    }
+    return;
+}
+
+
+int parseArguments(int argc, char *argv[])
+{
+    const char *statsVariable = getenv(STATS_VARIABLE);
+    int statsRequested = (statsVariable != NULL && *statsVariable != '\0' && strcmp(statsVariable, "0") != 0);
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strncmp(argv[i], INPUT_ARGUMENT, strlen(INPUT_ARGUMENT)) == 0)
+        {
+            inputPath = argv[i] + strlen(INPUT_ARGUMENT);
+            continue;
+        }
+        if (strncmp(argv[i], FORMAT_ARGUMENT, strlen(FORMAT_ARGUMENT)) == 0)
+        {
+            char *format = argv[i] + strlen(FORMAT_ARGUMENT);
+            if (strcmp(format, "text") != 0 && strcmp(format, "binary") != 0)
+            {
+                return INPUT_ERROR;
+            }
+            binaryInput = (strcmp(format, "binary") == 0);
+            continue;
+        }
+        if (strncmp(argv[i], OUTPUT_ARGUMENT, strlen(OUTPUT_ARGUMENT)) == 0)
+        {
+            char *outputName = argv[i] + strlen(OUTPUT_ARGUMENT);
+            output = 0;
+            while (output < NUMBER_OF_OUTPUTS && strcmp(outputName, outputNames[output]) != 0)
+            {
+                ++output;
+            }
+            if (output == NUMBER_OF_OUTPUTS)
+            {
+                return INPUT_ERROR;
+            }
+            continue;
+        }
+        if (strncmp(argv[i], PRECISION_ARGUMENT, strlen(PRECISION_ARGUMENT)) == 0)
+        {
+            char *precisionName = argv[i] + strlen(PRECISION_ARGUMENT);
+            precision = 0;
+            while (precision < NUMBER_OF_PRECISIONS && strcmp(precisionName, precisionNames[precision]) != 0)
+            {
+                ++precision;
+            }
+            if (precision == NUMBER_OF_PRECISIONS)
+            {
+                return INPUT_ERROR;
+            }
+            continue;
+        }
+        if (strncmp(argv[i], BINS_ARGUMENT, strlen(BINS_ARGUMENT)) == 0)
+        {
+            if (parsePositiveArgument(argv[i] + strlen(BINS_ARGUMENT), &binsCount) == INPUT_ERROR)
+            {
+                return INPUT_ERROR;
+            }
+            continue;
+        }
+        if (strncmp(argv[i], THREADS_ARGUMENT, strlen(THREADS_ARGUMENT)) == 0)
+        {
+            if (parsePositiveArgument(argv[i] + strlen(THREADS_ARGUMENT), &threadCount) == INPUT_ERROR)
+            {
+                return INPUT_ERROR;
+            }
+            continue;
+        }
+        if (strncmp(argv[i], TOLERANCE_ARGUMENT, strlen(TOLERANCE_ARGUMENT)) == 0)
+        {
+            char *end = NULL;
+            char *value = argv[i] + strlen(TOLERANCE_ARGUMENT);
+            tolerance = strtod(value, &end);
+            if (end == value || *end != '\0' || !(tolerance > 0))
+            {
+                return INPUT_ERROR;
+            }
+            continue;
+        }
+        if (strcmp(argv[i], STATS_ARGUMENT) == 0)
+        {
+            statsEnabled = 1;
+            continue;
+        }
+        if (strcmp(argv[i], FULL_ARGUMENT) == 0)
+        {
+            fullOutput = 1;
+            continue;
+        }
+        if (strcmp(argv[i], DEVIATION_ARGUMENT) == 0)
+        {
+            deviationCheck = 1;
+            continue;
+        }
+        if (strcmp(argv[i], STREAM_ARGUMENT) == 0 || strcmp(argv[i], BATCH_ARGUMENT) == 0 ||
+            strcmp(argv[i], ONLINE_ARGUMENT) == 0)
+        {
+            if (mode != MODE_SINGLE)
+            {
+                return INPUT_ERROR;
+            }
+            mode = (strcmp(argv[i], STREAM_ARGUMENT) == 0) ? MODE_STREAM :
+                   (strcmp(argv[i], ONLINE_ARGUMENT) == 0) ? MODE_ONLINE : MODE_BATCH;
+            continue;
+        }
+        if (strncmp(argv[i], CHANNELS_ARGUMENT, strlen(CHANNELS_ARGUMENT)) == 0)
+        {
+            if (mode != MODE_SINGLE ||
+                parsePositiveArgument(argv[i] + strlen(CHANNELS_ARGUMENT), &channelsCount) == INPUT_ERROR)
+            {
+                return INPUT_ERROR;
+            }
+            mode = MODE_CHANNELS;
+            continue;
+        }
+        if (strncmp(argv[i], BLOCK_ARGUMENT, strlen(BLOCK_ARGUMENT)) == 0)
+        {
+            if (parsePositiveArgument(argv[i] + strlen(BLOCK_ARGUMENT), &blockSize) == INPUT_ERROR)
+            {
+                return INPUT_ERROR;
+            }
+            continue;
+        }
+        if (strncmp(argv[i], ENGINE_ARGUMENT, strlen(ENGINE_ARGUMENT)) != 0)
+        {
+            return INPUT_ERROR;
+        }
+        char *engineName = argv[i] + strlen(ENGINE_ARGUMENT);
+        engine = 0;
+        while (engine < NUMBER_OF_ENGINES && strcmp(engineName, engineNames[engine]) != 0)
+        {
+            ++engine;
+        }
+        if (engine == NUMBER_OF_ENGINES)
+        {
+            return INPUT_ERROR;
+        }
+    }
+    // only a whole signal can be mapped, and the channels share one window
+    if ((binaryInput && mode != MODE_SINGLE) || (fullOutput && mode == MODE_CHANNELS) ||
+        (statsEnabled && mode != MODE_SINGLE))
+    {
+        return INPUT_ERROR;
+    }
+    // the reduced precision passes are direct ones, which only the deviation check compares
+    if ((precision != PRECISION_DOUBLE && (mode != MODE_SINGLE || fullOutput ||
+        (engine != ENGINE_AUTO && engine != ENGINE_DIRECT && engine != ENGINE_SIMD))) ||
+        (deviationCheck && precision == PRECISION_DOUBLE))
+    {
+        return INPUT_ERROR;
+    }
+    // the variable is for scraping every run, so it is ignored by the modes that have no stats
+    statsEnabled = statsEnabled || (statsRequested && mode == MODE_SINGLE);
+    return CORRECT_INPUT;
+}
+
+
+int parsePositiveArgument(char *value, int *result)
+{
+    char *end = NULL;
+    long parsed = strtol(value, &end, 10);
+    if (*value < '0' || *value > '9' || *end != '\0' || parsed <= 0 || parsed > INT_MAX)
+    {
+        return INPUT_ERROR;
+    }
+    *result = (int) parsed;
+    return CORRECT_INPUT;
+}
+
+
+int runStreamExperiment(FILE *stream)
+{
+    double *hSamples = NULL;
+    int hSize = 0;
+    int n = 0;
+    if (readSamples(stream, &hSamples, &hSize) != CORRECT_INPUT || readIterations(stream, &n) != CORRECT_INPUT ||
+        n < MINIMUM_ITERATIONS)
+    {
+        free(hSamples);
+        fprintf(stderr, "ERROR\n");
+        return EXIT_FAILURE;
+    }
+    normalizeArray(hSamples, hSize);
+    long kernelSize = 0;
+    double *kernel = kernelPower(hSamples, hSize, n, &kernelSize);
+    free(hSamples);
+    // a shorter block would pay for a transform of the kernel length anyway, so it takes every
+    // sample that the transform has room for
+    long transformSize = nextPowerOfTwo(((blockSize > kernelSize) ? blockSize : kernelSize) + kernelSize - 1);
+    long streamBlockSize = transformSize - kernelSize + 1;
+    double complex *kernelTransform = (double complex*) calloc(transformSize, sizeof(double complex));
+    double complex *blockTransform = (double complex*) malloc(sizeof(double complex) * transformSize);
+    double *block = (double*) malloc(sizeof(double) * streamBlockSize);
+    double *tail = (double*) calloc(kernelSize, sizeof(double));
+    if (kernel == NULL || kernelTransform == NULL || blockTransform == NULL || block == NULL || tail == NULL)
+    {
+        free(kernel);
+        free(kernelTransform);
+        free(blockTransform);
+        free(block);
+        free(tail);
+        fprintf(stderr, "ERROR\n");
+        return EXIT_FAILURE;
+    }
+    for (long i = 0; i < kernelSize; ++i)
+    {
+        kernelTransform[i] = kernel[i];
+    }
+    free(kernel);
+    fft(kernelTransform, transformSize, 0);
+    int result = CORRECT_INPUT;
+    long samplesRead = 0;
+    while (result == CORRECT_INPUT)
+    {
+        long blockLength = 0;
+        while (blockLength < streamBlockSize &&
+               (result = readNextSample(stream, &block[blockLength], 0)) == CORRECT_INPUT)
+        {
+            ++blockLength;
+        }
+        if (blockLength == 0)
+        {
+            break;
+        }
+        samplesRead = samplesRead + blockLength;
+        for (long i = 0; i < transformSize; ++i)
+        {
+            blockTransform[i] = (i < blockLength) ? block[i] : 0;
+        }
+        fft(blockTransform, transformSize, 0);
+        for (long i = 0; i < transformSize; ++i)
+        {
+            blockTransform[i] = blockTransform[i] * kernelTransform[i];
+        }
+        fft(blockTransform, transformSize, 1);
+        // the first blockLength values are final, the rest overlaps the next blocks
+        for (long i = 0; i < blockLength + kernelSize - 1; ++i)
+        {
+            double value = creal(blockTransform[i]) + ((i < kernelSize - 1) ? tail[i] : 0);
+            if (i < blockLength)
+            {
+                printf("%0.3f\n", (value > 0) ? value : 0);
+            }
+            else
+            {
+                tail[i - blockLength] = value;
+            }
+        }
+    }
+    if (result != INPUT_ERROR && samplesRead > 0)
+    {
+        for (long i = 0; i < kernelSize - 1; ++i)
+        {
+            printf("%0.3f\n", (tail[i] > 0) ? tail[i] : 0);
+        }
+    }
+    free(kernelTransform);
+    free(blockTransform);
+    free(block);
+    free(tail);
+    if (result == INPUT_ERROR)
+    {
+        fprintf(stderr, "ERROR\n");
+        return EXIT_FAILURE;
+    }
+    return SUCCESSFUL_EXIT_CODE;
+}
+
+
+int runOnlineExperiment(FILE *stream)
+{
+    double *hSamples = NULL;
+    int hSize = 0;
+    int n = 0;
+    OnlineConvolution online;
+    int result = readSamples(stream, &hSamples, &hSize);
+    if (result == CORRECT_INPUT)
+    {
+        result = readIterations(stream, &n);
+    }
+    if (result == CORRECT_INPUT && n < MINIMUM_ITERATIONS)
+    {
+        result = INPUT_ERROR;
+    }
+    if (result == CORRECT_INPUT)
+    {
+        normalizeArray(hSamples, hSize);
+        result = createOnlineConvolution(&online, hSamples, hSize, n);
+    }
+    free(hSamples);
+    if (result != CORRECT_INPUT)
+    {
+        fprintf(stderr, "ERROR\n");
+        return EXIT_FAILURE;
+    }
+    int c;
+    while (result == CORRECT_INPUT && (c = getc(stream)) != EOF)
+    {
+        ungetc(c, stream);
+        double *samples = NULL;
+        int count = 0;
+        long first = 0;
+        result = readSamples(stream, &samples, &count);
+        if (result == CORRECT_INPUT && count > 0)
+        {
+            result = appendOnlineSamples(&online, samples, count, &first);
+        }
+        free(samples);
+        if (result != CORRECT_INPUT || count == 0)
+        {
+            continue;
+        }
+        for (long i = first; i < online.resultSize; ++i)
+        {
+            printf("%ld,%0.3f\n", i, (online.result[i] > 0) ? online.result[i] : 0);
+        }
+        printf("\n");
+        // the values are for a live consumer, so every update is delivered as soon as it is ready
+        fflush(stdout);
+    }
+    freeOnlineConvolution(&online);
+    if (result != CORRECT_INPUT)
+    {
+        fprintf(stderr, "ERROR\n");
+        return EXIT_FAILURE;
+    }
+    return SUCCESSFUL_EXIT_CODE;
+}
+
+
+int createOnlineConvolution(OnlineConvolution *online, double *h, int hSize, int n)
+{
+    long kernelSize = 0;
+    (*online).kernel = NULL;
+    (*online).result = NULL;
+    (*online).resultSize = 0;
+    (*online).capacity = 0;
+    (*online).samplesCount = 0;
+    if (hSize > 0 && (long) n * (hSize - 1) + 1 > INT_MAX)
+    {
+        return INPUT_ERROR;
+    }
+    (*online).kernel = kernelPower(h, hSize, n, &kernelSize);
+    (*online).kernelSize = (int) kernelSize;
+    return ((*online).kernel == NULL) ? ALLOCATION_ERROR : CORRECT_INPUT;
+}
+
+
+int appendOnlineSamples(OnlineConvolution *online, const double *samples, int count, long *firstUpdated)
+{
+    long samplesCount = (*online).samplesCount + count;
+    long resultSize = samplesCount + (*online).kernelSize - 1;
+    if (resultSize > (*online).capacity)
+    {
+        long capacity = ((*online).capacity > 0) ? (*online).capacity : INITIAL_BUFFER_CAPACITY;
+        while (capacity < resultSize)
+        {
+            capacity = capacity * 2;
+        }
+        double *grown = (double*) realloc((*online).result, sizeof(double) * capacity);
+        if (grown == NULL)
+        {
+            return ALLOCATION_ERROR;
+        }
+        (*online).result = grown;
+        (*online).capacity = capacity;
+    }
+    // the values after the old result are touched by the new samples only
+    memset((*online).result + (*online).resultSize, 0, sizeof(double) * (resultSize - (*online).resultSize));
+    *firstUpdated = (*online).samplesCount;
+    for (int i = 0; i < count; ++i)
+    {
+        addScaled((*online).result + (*online).samplesCount + i, (*online).kernel, samples[i],
+                  (*online).kernelSize);
+    }
+    (*online).samplesCount = samplesCount;
+    (*online).resultSize = resultSize;
+    return CORRECT_INPUT;
+}
+
+
+void freeOnlineConvolution(OnlineConvolution *online)
+{
+    free((*online).kernel);
+    free((*online).result);
+    (*online).kernel = NULL;
+    (*online).result = NULL;
+    return;
+}
+
+
+int runBatchExperiments(FILE *stream)
+{
+    BatchKernel **kernels = NULL;
+    int kernelsCount = 0;
+    int kernelsCapacity = 0;
+    BatchRecord *records = (BatchRecord*) malloc(sizeof(BatchRecord) * BATCH_RECORDS_CAPACITY);
+    int recordsCount = 0;
+    int result = (records == NULL) ? ALLOCATION_ERROR : CORRECT_INPUT;
+    char *line = NULL;
+    while (result == CORRECT_INPUT && (line = readLine(stream)) != NULL)
+    {
+        result = parseBatchLine(line, &kernels, &kernelsCount, &kernelsCapacity, records, &recordsCount);
+        free(line);
+        if (result == CORRECT_INPUT && recordsCount == BATCH_RECORDS_CAPACITY)
+        {
+            result = processBatch(records, recordsCount);
+            recordsCount = 0;
+        }
+    }
+    if (result == CORRECT_INPUT)
+    {
+        result = processBatch(records, recordsCount);
+    }
+    else
+    {
+        for (int i = 0; i < recordsCount; ++i)
+        {
+            free(records[i].experiment.g);
+        }
+    }
+    free(records);
+    freeBatchKernels(kernels, kernelsCount);
+    if (result != CORRECT_INPUT)
+    {
+        fprintf(stderr, "ERROR\n");
+        return EXIT_FAILURE;
+    }
+    return SUCCESSFUL_EXIT_CODE;
+}
+
+
+int parseBatchLine(char *line, BatchKernel ***kernels, int *kernelsCount, int *kernelsCapacity,
+                   BatchRecord *records, int *recordsCount)
+{
+    char *tag = strtok(line, INPUT_DIVIDERS);
+    if (tag == NULL)
+    {
+        return CORRECT_INPUT;
+    }
+    if (strcmp(tag, KERNEL_TAG) == 0)
+    {
+        if (*kernelsCount == *kernelsCapacity)
+        {
+            int capacity = (*kernelsCapacity > 0) ? *kernelsCapacity * 2 : INITIAL_BUFFER_CAPACITY;
+            BatchKernel **grown = (BatchKernel**) realloc(*kernels, sizeof(BatchKernel*) * capacity);
+            if (grown == NULL)
+            {
+                return ALLOCATION_ERROR;
+            }
+            *kernels = grown;
+            *kernelsCapacity = capacity;
+        }
+        BatchKernel *kernel = (BatchKernel*) malloc(sizeof(BatchKernel));
+        if (kernel == NULL)
+        {
+            return ALLOCATION_ERROR;
+        }
+        (*kernel).plans = NULL;
+        (*kernel).plansCount = 0;
+        (*kernels)[(*kernelsCount)++] = kernel;
+        int result = parseRemainingSamples(&(*kernel).h, &(*kernel).hSize);
+        (*kernel).scale = normalizeArray((*kernel).h, (*kernel).hSize);
+        return result;
+    }
+    char *iterations = strtok(NULL, INPUT_DIVIDERS);
+    if (strcmp(tag, RECORD_TAG) != 0 || *kernelsCount == 0 || iterations == NULL)
+    {
+        return INPUT_ERROR;
+    }
+    BatchKernel *kernel = (*kernels)[*kernelsCount - 1];
+    Experiment *experiment = &records[*recordsCount].experiment;
+    (*experiment).stats = NULL;
+    if (parseIterations(iterations, &(*experiment).n) == INPUT_ERROR)
+    {
+        return INPUT_ERROR;
+    }
+    int result = parseRemainingSamples(&(*experiment).g, &(*experiment).gSize);
+    if (result == CORRECT_INPUT && (*kernel).hSize > (*experiment).gSize)
+    {
+        result = INPUT_ERROR;
+    }
+    KernelPlan *plan = NULL;
+    if (result == CORRECT_INPUT && (plan = batchKernelPlan(kernel, windowSizeFor((*experiment).gSize))) == NULL)
+    {
+        result = ALLOCATION_ERROR;
+    }
+    // the spectrum is added while a single thread parses, so the rendering threads only read it
+    if (result == CORRECT_INPUT && engine == ENGINE_FFT && !fullOutput && (*experiment).n > MINIMUM_ITERATIONS)
+    {
+        result = cacheKernelSpectrum(plan, (*experiment).n);
+    }
+    if (result == CORRECT_INPUT)
+    {
+        result = prepareSignal(experiment, plan);
+    }
+    if (result != CORRECT_INPUT)
+    {
+        free((*experiment).g);
+        return result;
+    }
+    ++(*recordsCount);
+    return CORRECT_INPUT;
+}
+
+
+int parseRemainingSamples(double **samples, int *size)
+{
+    int capacity = INITIAL_BUFFER_CAPACITY;
+    *size = 0;
+    *samples = (double*) malloc(sizeof(double) * capacity);
+    if (*samples == NULL)
+    {
+        return ALLOCATION_ERROR;
+    }
+    char *token = strtok(NULL, INPUT_DIVIDERS);
+    while (token != NULL)
+    {
+        double sample = extractDoubleFromString(token);
+        if (sample == INPUT_ERROR)
+        {
+            return INPUT_ERROR;
+        }
+        if (appendSample(samples, size, &capacity, sample) == ALLOCATION_ERROR)
+        {
+            return ALLOCATION_ERROR;
+        }
+        token = strtok(NULL, INPUT_DIVIDERS);
+    }
+    return CORRECT_INPUT;
+}
+
+
+KernelPlan *batchKernelPlan(BatchKernel *kernel, int windowSize)
+{
+    for (int i = 0; i < (*kernel).plansCount; ++i)
+    {
+        if ((*(*kernel).plans[i]).windowSize == windowSize)
+        {
+            return (*kernel).plans[i];
+        }
+    }
+    KernelPlan **grown = (KernelPlan**) realloc((*kernel).plans, sizeof(KernelPlan*) * ((*kernel).plansCount + 1));
+    if (grown == NULL)
+    {
+        return NULL;
+    }
+    (*kernel).plans = grown;
+    KernelPlan *plan = (KernelPlan*) malloc(sizeof(KernelPlan));
+    if (plan == NULL)
+    {
+        return NULL;
+    }
+    if (createKernelPlan(plan, (*kernel).h, (*kernel).hSize, windowSize) == ALLOCATION_ERROR)
+    {
+        freeKernelPlan(plan);
+        free(plan);
+        return NULL;
+    }
+    (*plan).scale = (*kernel).scale;
+    (*kernel).plans[(*kernel).plansCount++] = plan;
+    return plan;
+}
+
+
+int processBatch(BatchRecord *records, int recordsCount)
+{
+    BatchWorker worker;
+    worker.records = records;
+    worker.recordsCount = recordsCount;
+    worker.nextRecord = 0;
+    pthread_mutex_init(&worker.lock, NULL);
+    int workersCount = (threadCount < recordsCount) ? threadCount : recordsCount;
+    pthread_t *workerThreads = (pthread_t*) malloc(sizeof(pthread_t) * (workersCount > 0 ? workersCount : 1));
+    int started = 0;
+    // the calling thread takes records as well, so the batch completes even if no thread starts
+    while (workerThreads != NULL && started < workersCount - 1 &&
+           pthread_create(&workerThreads[started], NULL, batchWorker, &worker) == 0)
+    {
+        ++started;
+    }
+    batchWorker(&worker);
+    for (int i = 0; i < started; ++i)
+    {
+        pthread_join(workerThreads[i], NULL);
+    }
+    free(workerThreads);
+    pthread_mutex_destroy(&worker.lock);
+    int result = CORRECT_INPUT;
+    for (int i = 0; i < recordsCount; ++i)
+    {
+        if (records[i].result == CORRECT_INPUT && result == CORRECT_INPUT)
+        {
+            fwrite(records[i].output, 1, records[i].outputSize, stdout);
+        }
+        else
+        {
+            result = ALLOCATION_ERROR;
+        }
+        free(records[i].output);
+        free(records[i].experiment.g);
+    }
+    return result;
+}
+
+
+void *batchWorker(void *argument)
+{
+    BatchWorker *worker = (BatchWorker*) argument;
+    while (1)
+    {
+        pthread_mutex_lock(&(*worker).lock);
+        int index = (*worker).nextRecord++;
+        pthread_mutex_unlock(&(*worker).lock);
+        if (index >= (*worker).recordsCount)
+        {
+            return NULL;
+        }
+        BatchRecord *record = &(*worker).records[index];
+        (*record).output = NULL;
+        (*record).outputSize = 0;
+        FILE *out = open_memstream(&(*record).output, &(*record).outputSize);
+        (*record).result = (out == NULL) ? ALLOCATION_ERROR : renderExperiment(&(*record).experiment, out, 1);
+        if (out != NULL && fclose(out) != 0)
+        {
+            (*record).result = ALLOCATION_ERROR;
+        }
+    }
+}
+
+
+void freeBatchKernels(BatchKernel **kernels, int kernelsCount)
+{
+    for (int i = 0; i < kernelsCount; ++i)
+    {
+        for (int j = 0; j < (*kernels[i]).plansCount; ++j)
+        {
+            freeKernelPlan((*kernels[i]).plans[j]);
+            free((*kernels[i]).plans[j]);
+        }
+        free((*kernels[i]).plans);
+        free((*kernels[i]).h);
+        free(kernels[i]);
+    }
+    free(kernels);
+    return;
+}
+
+
+int runChannelsExperiment(FILE *stream)
+{
+    Experiment *channels = (Experiment*) calloc(channelsCount, sizeof(Experiment));
+    KernelPlan kernel;
+    double *hSamples = NULL;
+    int hSize = 0;
+    double *signals = NULL;
+    double *resultArray = NULL;
+    kernel.h = NULL;
+    kernel.reversedTaps = NULL;
+    kernel.tapShifts = NULL;
+    kernel.tapWeights = NULL;
+    kernel.spectra = NULL;
+    kernel.spectraCount = 0;
+    int result = (channels == NULL) ? ALLOCATION_ERROR : parseChannels(stream, channels, &hSamples, &hSize);
+    if (result == CORRECT_INPUT)
+    {
+        result = prepareInputForConvolution(&channels[0], &kernel, hSamples, hSize);
+    }
+    for (int c = 1; c < channelsCount && result == CORRECT_INPUT; ++c)
+    {
+        result = prepareSignal(&channels[c], &kernel);
+    }
+    int windowSize = kernel.windowSize;
+    int n = (channels == NULL) ? 0 : channels[0].n;
+    if (result == CORRECT_INPUT && n > MINIMUM_ITERATIONS)
+    {
+        long size = (long) windowSize * channelsCount;
+        signals = (double*) malloc(sizeof(double) * size);
+        resultArray = (double*) malloc(sizeof(double) * size);
+        result = (signals == NULL || resultArray == NULL) ? ALLOCATION_ERROR : CORRECT_INPUT;
+        for (int c = 0; c < channelsCount && result == CORRECT_INPUT; ++c)
+        {
+            for (int k = 0; k < windowSize; ++k)
+            {
+                signals[(long) k * channelsCount + c] = channels[c].g[k];
+            }
+        }
+        if (result == CORRECT_INPUT)
+        {
+            result = channelConvolutions(&kernel, signals, channelsCount, n, resultArray, &channels[0].iterationsRun);
+        }
+        // every channel window now holds the result of its channel
+        for (int c = 0; c < channelsCount && result == CORRECT_INPUT; ++c)
+        {
+            for (int k = 0; k < windowSize; ++k)
+            {
+                channels[c].g[k] = resultArray[(long) k * channelsCount + c];
+            }
+        }
+    }
+    for (int c = 0; c < channelsCount && result == CORRECT_INPUT; ++c)
+    {
+        if ((result = renderValues(stdout, channels[c].g, windowSize)) == CORRECT_INPUT)
+        {
+            printf("\n");
+        }
+    }
+    if (result == CORRECT_INPUT && tolerance > 0 && n > MINIMUM_ITERATIONS)
+    {
+        fprintf(stderr, "Iterations: %d\n", channels[0].iterationsRun);
+    }
+    for (int c = 0; channels != NULL && c < channelsCount; ++c)
+    {
+        free(channels[c].g);
+    }
+    free(channels);
+    free(hSamples);
+    freeKernelPlan(&kernel);
+    free(signals);
+    free(resultArray);
+    if (result != CORRECT_INPUT)
+    {
+        fprintf(stderr, "ERROR\n");
+        return EXIT_FAILURE;
+    }
+    return SUCCESSFUL_EXIT_CODE;
+}
+
+
+int parseChannels(FILE *stream, Experiment *channels, double **hSamples, int *hSize)
+{
+    for (int c = 0; c < channelsCount; ++c)
+    {
+        int result = readSamples(stream, &channels[c].g, &channels[c].gSize);
+        if (result != CORRECT_INPUT)
+        {
+            return result;
+        }
+        if (channels[c].gSize != channels[0].gSize)
+        {
+            return INPUT_ERROR;
+        }
+    }
+    int result = readSamples(stream, hSamples, hSize);
+    if (result != CORRECT_INPUT)
+    {
+        return result;
+    }
+    if (*hSize > channels[0].gSize || readIterations(stream, &channels[0].n) != CORRECT_INPUT)
+    {
+        return INPUT_ERROR;
+    }
+    for (int c = 1; c < channelsCount; ++c)
+    {
+        channels[c].n = channels[0].n;
+    }
+    return CORRECT_INPUT;
+}
+
+
+int channelConvolutions(const KernelPlan *kernel, const double *signals, int channels, int n,
+                        double *resultArray, int *iterationsRun)
+{
+    int windowSize = (*kernel).windowSize;
+    long size = (long) windowSize * channels;
+    double *temp = (double*) malloc(sizeof(double) * size);
+    if (temp == NULL)
+    {
+        return ALLOCATION_ERROR;
+    }
+    memcpy(temp, signals, sizeof(double) * size);
+    *iterationsRun = n;
+    for (int i = 0; i < n; ++i)
+    {
+        for (int j = 0; j < windowSize; ++j)
+        {
+            double *out = resultArray + (long) j * channels;
+            memset(out, 0, sizeof(double) * channels);
+            // the same range of g indices as in directConvolutionAt
+            int base = j + (*kernel).offset - (*kernel).high;
+            int first = (base > 0) ? base : 0;
+            int last = base + (*kernel).hSize - 1;
+            last = (last < windowSize - 1) ? last : windowSize - 1;
+            for (int k = first; k <= last; ++k)
+            {
+                addScaled(out, temp + (long) k * channels, (*kernel).reversedTaps[k - base], channels);
+            }
+        }
+        if (hasConverged(resultArray, temp, (int) size))
+        {
+            *iterationsRun = i + 1;
+            break;
+        }
+        memcpy(temp, resultArray, sizeof(double) * size);
+    }
+    free(temp);
+    return CORRECT_INPUT;
+}
+
+
+void addScaled(double *out, const double *in, double weight, int length)
+{
+    int i = 0;
+#ifdef AVX2_DISPATCH
+    if (__builtin_cpu_supports("avx2"))
+    {
+        i = avx2AddScaled(out, in, weight, length);
+    }
+#endif
+    for (; i < length; ++i)
+    {
+        out[i] = out[i] + weight * in[i];
+    }
+    return;
+}
+
+
+#ifdef AVX2_DISPATCH
+__attribute__((target("avx2")))
+int avx2AddScaled(double *out, const double *in, double weight, int length)
+{
+    int i = 0;
+    __m256d weights = _mm256_set1_pd(weight);
+    for (; i + VECTOR_LANES <= length; i += VECTOR_LANES)
+    {
+        __m256d product = _mm256_mul_pd(weights, _mm256_loadu_pd(in + i));
+        _mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_loadu_pd(out + i), product));
+    }
+    return i;
+}
+#endif
+
+
+double *kernelPower(double *kernel, int kernelSize, int iterations, long *powerSize)
+{
+    *powerSize = (kernelSize > 0) ? (long)iterations * (kernelSize - 1) + 1 : 1;
+    double *power = (double*) calloc(*powerSize, sizeof(double));
+    long transformSize = nextPowerOfTwo(*powerSize);
+    double complex *transform = (double complex*) calloc(transformSize, sizeof(double complex));
+    if (power == NULL || transform == NULL)
+    {
+        free(power);
+        free(transform);
+        return NULL;
+    }
+    if (kernelSize == 0)
+    {
+        free(transform);
+        return power;
+    }
+    for (int i = 0; i < kernelSize; ++i)
+    {
+        transform[i] = kernel[i];
+    }
+    fft(transform, transformSize, 0);
+    for (long i = 0; i < transformSize; ++i)
+    {
+        transform[i] = complexPower(transform[i], iterations);
+    }
+    fft(transform, transformSize, 1);
+    for (long i = 0; i < *powerSize; ++i)
+    {
+        power[i] = (creal(transform[i]) > 0) ? creal(transform[i]) : 0;
+    }
+    free(transform);
+    return power;
+}
+
+
+int parseInput(FILE *stream, Experiment *experiment, double **hSamples, int *hSize)
+{
+    int result = readSamples(stream, &(*experiment).g, &(*experiment).gSize);
+    if (result != CORRECT_INPUT)
+    {
+        return result;
+    }
+    result = readSamples(stream, hSamples, hSize);
+    if (result != CORRECT_INPUT)
+    {
+        return result;
+    }
+    if (*hSize > (*experiment).gSize)
+    {
+        return INPUT_ERROR;
+    }
+    return readIterations(stream, &(*experiment).n);
+}
+
+int mapInput(FILE *stream, Experiment *experiment, double **hSamples, int *hSize, MappedInput *mapping)
+{
+    struct stat status;
+    int descriptor = fileno(stream);
+    if (fstat(descriptor, &status) != 0 || !S_ISREG(status.st_mode) || status.st_size < BINARY_HEADER_SIZE)
+    {
+        return INPUT_ERROR;
+    }
+    void *address = mmap(NULL, status.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, descriptor, 0);
+    if (address == MAP_FAILED)
+    {
+        return ALLOCATION_ERROR;
+    }
+    (*mapping).address = address;
+    (*mapping).length = status.st_size;
+    const unsigned char *header = (const unsigned char*) address;
+    uint64_t gLength = decodeLittleEndian(header + 8);
+    uint64_t hLength = decodeLittleEndian(header + 16);
+    int64_t iterations = (int64_t) decodeLittleEndian(header + 24);
+    if (memcmp(header, BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0 || gLength > INT_MAX || hLength > gLength ||
+        iterations > INT_MAX || iterations < INT_MIN ||
+        (uint64_t) status.st_size != BINARY_HEADER_SIZE + sizeof(double) * (gLength + hLength))
+    {
+        return INPUT_ERROR;
+    }
+    // the header is a multiple of 8 bytes and the mapping is page aligned, so the samples are aligned
+    double *samples = (double*) (header + BINARY_HEADER_SIZE);
+    if (decodeSamples(samples, (long) (gLength + hLength)) == INPUT_ERROR)
+    {
+        return INPUT_ERROR;
+    }
+    (*experiment).gSize = (int) gLength;
+    (*experiment).n = (int) iterations;
+    (*experiment).g = samples;
+    *hSamples = samples + gLength;
+    *hSize = (int) hLength;
+    if ((*experiment).gSize < windowSizeFor((*experiment).gSize))
+    {
+        (*experiment).g = (double*) malloc(sizeof(double) * (gLength > 0 ? gLength : 1));
+        if ((*experiment).g == NULL)
+        {
+            return ALLOCATION_ERROR;
+        }
+        memcpy((*experiment).g, samples, sizeof(double) * gLength);
+    }
+    return CORRECT_INPUT;
+}
+
+
+uint64_t decodeLittleEndian(const unsigned char *bytes)
+{
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; --i)
+    {
+        value = (value << 8) | bytes[i];
+    }
+    return value;
+}
+
+
+int decodeSamples(double *samples, long size)
+{
+    const uint16_t probe = 1;
+    int littleEndian = (*(const unsigned char*) &probe == 1);
+    for (long i = 0; i < size; ++i)
+    {
+        if (!littleEndian)
+        {
+            uint64_t bits = decodeLittleEndian((const unsigned char*) &samples[i]);
+            memcpy(&samples[i], &bits, sizeof(double));
+        }
+        if (!(samples[i] >= 0) || isinf(samples[i]))
+        {
+            return INPUT_ERROR;
+        }
+    }
+    return CORRECT_INPUT;
+}
+
+
+void releaseSamples(double *samples, const MappedInput *mapping)
+{
+    const char *start = (const char*) (*mapping).address;
+    if (start == NULL || (const char*) samples < start || (const char*) samples >= start + (*mapping).length)
+    {
+        free(samples);
+    }
+    return;
+}
+
+
+int readIterations(FILE *stream, int *iterations)
+{
+    char *nInput = readLine(stream);
+    if (nInput == NULL)
+    {
+        return INPUT_ERROR;
+    }
+    int result = parseIterations(nInput, iterations);
+    free(nInput);
+    return result;
+}
+
+
+int parseIterations(char *text, int *iterations)
+{
+    if (findDecimalPointPosition(text) != (int) strlen(text))
+    {
+        return INPUT_ERROR;
+    }
+    *iterations = (int) extractDoubleFromString(text);
+    return CORRECT_INPUT;
+}
+
+int readSamples(FILE *stream, double **samples, int *size)
+{
+    int capacity = INITIAL_BUFFER_CAPACITY;
+    *size = 0;
+    *samples = (double*) malloc(sizeof(double) * capacity);
+    if (*samples == NULL)
+    {
+        return ALLOCATION_ERROR;
+    }
+    int c = readByte(stream);
+    if (c == EOF)
+    {
+        return INPUT_ERROR;
+    }
+    unreadByte(c, stream);
+    double sample;
+    int result;
+    while ((result = readNextSample(stream, &sample, 1)) == CORRECT_INPUT)
+    {
+        if (appendSample(samples, size, &capacity, sample) == ALLOCATION_ERROR)
+        {
+            return ALLOCATION_ERROR;
+        }
+    }
+    return (result == END_OF_SAMPLES) ? CORRECT_INPUT : result;
+}
+
+
+int readNextSample(FILE *stream, double *sample, int stopAtLineBreak)
+{
+    int c = readByte(stream);
+    while (c != EOF && strchr(INPUT_DIVIDERS, c) != NULL && !(stopAtLineBreak && c == '\n'))
+    {
+        c = readByte(stream);
+    }
+    if (c == EOF || c == '\n')
+    {
+        return END_OF_SAMPLES;
+    }
+    // a valid sample is never longer than MAX_VALUE_LENGTH, one extra char marks a too long one
+    char token[MAX_VALUE_LENGTH + 2];
+    int tokenLength = 0;
+    while (c != EOF && strchr(INPUT_DIVIDERS, c) == NULL)
+    {
+        if (tokenLength <= MAX_VALUE_LENGTH)
+        {
+            token[tokenLength++] = (char) c;
+        }
+        c = readByte(stream);
+    }
+    if (c == '\n')
+    {
+        // leaves the line break for the next call so the line ends there
+        unreadByte(c, stream);
+    }
+    token[tokenLength] = '\0';
+    *sample = extractDoubleFromString(token);
+    return (*sample == INPUT_ERROR) ? INPUT_ERROR : CORRECT_INPUT;
+}
+
+
+int appendSample(double **samples, int *size, int *capacity, double sample)
+{
+    if (*size == *capacity)
+    {
+        double *grown = (double*) realloc(*samples, sizeof(double) * (*capacity) * 2);
+        if (grown == NULL)
+        {
+            return ALLOCATION_ERROR;
+        }
+        *samples = grown;
+        *capacity = (*capacity) * 2;
+    }
+    (*samples)[*size] = sample;
+    ++(*size);
+    return CORRECT_INPUT;
+}
+
+
+char *readLine(FILE *stream)
+{
+    int capacity = INITIAL_BUFFER_CAPACITY;
+    int length = 0;
+    char *line = (char*) malloc(capacity);
+    int c = readByte(stream);
+    if (line == NULL || c == EOF)
+    {
+        free(line);
+        return NULL;
+    }
+    while (c != EOF && c != '\n')
+    {
+        if (length + 1 == capacity)
+        {
+            char *grown = (char*) realloc(line, capacity * 2);
+            if (grown == NULL)
+            {
+                free(line);
+                return NULL;
+            }
+            line = grown;
+            capacity = capacity * 2;
+        }
+        line[length++] = (char) c;
+        c = readByte(stream);
+    }
+    line[length] = '\0';
+    return line;
+}
+
+
+int fitToWindow(double **array, int arraySize, int windowSize)
+{
+    double *resized = (double*) realloc(*array, sizeof(double) * windowSize);
+    if (resized == NULL)
+    {
+        return ALLOCATION_ERROR;
+    }
+    *array = resized;
+    for (int i = arraySize; i < windowSize; ++i)
+    {
+        (*array)[i] = 0;
+    }
+    return CORRECT_INPUT;
+}
+
+
+int renderValues(FILE *out, double array[], int arraySize)
+{
+    if (output == OUTPUT_CSV)
+    {
+        return writeValues(out, array, arraySize);
+    }
+    if (output == OUTPUT_BINNED)
+    {
+        return binnedHistogram(out, array, arraySize, binsCount);
+    }
+    return histogram(out, array, arraySize);
+}
+
+
+int histogram(FILE *out, double array[], int arraySize)
+{
+    if(array[indexOfMaxValue(array, arraySize)] <= EPSILON)
+    {
+        return CORRECT_INPUT;
+    }
+    roundBeforeHistogram(array, arraySize);
+    double max = array[indexOfMaxValue(array, arraySize)];
+    OutputBuffer buffer = {NULL, 0, 0};
+    for (int i = 0; i < arraySize; ++i)
+    {
+        if (reserveOutput(&buffer, OUTPUT_ROW_CAPACITY) == ALLOCATION_ERROR)
+        {
+            free(buffer.data);
+            return ALLOCATION_ERROR;
+        }
+        appendHistogramRow(&buffer, "", array[i], max);
+    }
+    flushOutput(out, &buffer);
+    return CORRECT_INPUT;
+}
+
+
+int binnedHistogram(FILE *out, const double array[], int arraySize, int bins)
+{
+    bins = (bins < arraySize) ? bins : arraySize;
+    double *sums = (double*) calloc(bins > 0 ? bins : 1, sizeof(double));
+    if (sums == NULL)
+    {
+        return ALLOCATION_ERROR;
+    }
+    for (int i = 0; i < arraySize; ++i)
+    {
+        sums[(int) ((long) i * bins / arraySize)] += array[i];
+    }
+    int result = CORRECT_INPUT;
+    if (bins > 0 && sums[indexOfMaxValue(sums, bins)] > EPSILON)
+    {
+        roundBeforeHistogram(sums, bins);
+        double max = sums[indexOfMaxValue(sums, bins)];
+        OutputBuffer buffer = {NULL, 0, 0};
+        char label[OUTPUT_ROW_CAPACITY];
+        for (int b = 0; b < bins && result == CORRECT_INPUT; ++b)
+        {
+            // bin b holds the indices i with i * bins / arraySize == b
+            long first = ((long) b * arraySize + bins - 1) / bins;
+            long last = ((long) (b + 1) * arraySize + bins - 1) / bins - 1;
+            snprintf(label, sizeof(label), "%ld-%ld ", first, last);
+            result = reserveOutput(&buffer, 2 * OUTPUT_ROW_CAPACITY);
+            if (result == CORRECT_INPUT)
+            {
+                appendHistogramRow(&buffer, label, sums[b], max);
+            }
+        }
+        if (result == CORRECT_INPUT)
+        {
+            flushOutput(out, &buffer);
+        }
+        else
+        {
+            free(buffer.data);
+        }
+    }
+    free(sums);
+    return result;
+}
+
+
+int writeValues(FILE *out, const double array[], int arraySize)
+{
+    OutputBuffer buffer = {NULL, 0, 0};
+    for (int i = 0; i < arraySize; ++i)
+    {
+        if (reserveOutput(&buffer, OUTPUT_ROW_CAPACITY) == ALLOCATION_ERROR)
+        {
+            free(buffer.data);
+            return ALLOCATION_ERROR;
+        }
+        buffer.size += snprintf(buffer.data + buffer.size, OUTPUT_ROW_CAPACITY, "%d,%.17g\n", i, array[i]);
+    }
+    flushOutput(out, &buffer);
+    return CORRECT_INPUT;
+}
+
+
+void appendHistogramRow(OutputBuffer *buffer, const char *label, double value, double max)
+{
+    char *row = (*buffer).data + (*buffer).size;
+    int length = snprintf(row, OUTPUT_ROW_CAPACITY - HISTOGRAM_WIDTH - 1, "%s%0.3f: ", label, value);
+    // a maximum that rounds to 0 prints no asterisks
+    int asterisks = (max > 0 && value > 0) ? (int) floor((value / max) * HISTOGRAM_WIDTH) : 0;
+    for (int i = 0; i < asterisks; ++i)
+    {
+        row[length + i] = '*';
+    }
+    row[length + asterisks] = '\n';
+    (*buffer).size += length + asterisks + 1;
+    return;
+}
+
+
+int reserveOutput(OutputBuffer *buffer, size_t length)
+{
+    if ((*buffer).size + length <= (*buffer).capacity)
+    {
+        return CORRECT_INPUT;
+    }
+    size_t capacity = ((*buffer).capacity > 0) ? (*buffer).capacity : INITIAL_BUFFER_CAPACITY;
+    while (capacity < (*buffer).size + length)
+    {
+        capacity = capacity * 2;
+    }
+    char *data = (char*) realloc((*buffer).data, capacity);
+    if (data == NULL)
+    {
+        return ALLOCATION_ERROR;
+    }
+    (*buffer).data = data;
+    (*buffer).capacity = capacity;
+    return CORRECT_INPUT;
+}
+
+
+void flushOutput(FILE *out, OutputBuffer *buffer)
+{
+    fwrite((*buffer).data, 1, (*buffer).size, out);
+    free((*buffer).data);
+    (*buffer).data = NULL;
+    (*buffer).size = 0;
+    (*buffer).capacity = 0;
+    return;
+}
+
+
+
+int indexOfMaxValue(double *array, int arraySize)
+{
+	int max = 0;
+	for (int i = 0; i < arraySize; ++i)
+	{
+		if (array[i] > array[max])
+		{
+			max = i;
+		}
+	}
+	return max;
+}
+
+
+void roundBeforeHistogram(double *array, int arraySize)
+{
+	for(int i = 0; i < arraySize; ++i)
+	{
+        array[i] = (round(array[i] * 1000)) / 1000;
+	}
+	return;
+}
+
+
+int parameterization(int t, int size)
+{
+	return (t + (floor(size / 2)));
+}
+
+
+int nConvolutions(Experiment *experiment, double *resultArray)
+{
+	int windowSize = (*(*experiment).kernel).windowSize;
+	double *temp = (double*) malloc(sizeof(double) * windowSize);
+	if (temp == NULL)
+	{
+		return ALLOCATION_ERROR;
+	}
+	memcpy(temp, (*experiment).g, sizeof(double) * windowSize);
+	for (int i = 0; i < (*experiment).n; ++i)
+	{
+		int j = 0;
+        int t = -ceil((double)windowSize / 2)-1;
+		while(j < windowSize)
+		{
+                resultArray[j] = singleConvolution((*experiment).kernel, temp, t);
+				++j;
+                ++t;
+		}
+		if (hasConverged(resultArray, temp, windowSize))
+		{
+			(*experiment).iterationsRun = i + 1;
+			break;
+		}
+		memcpy(temp, resultArray, sizeof(double) * windowSize);
+	}
+	countMultiplyAdds(experiment, (*experiment).iterationsRun * passMultiplyAdds((*experiment).kernel, 1));
+	free(temp);
+	return CORRECT_INPUT;
+}
+
+
+int applyConvolutions(Experiment *experiment, double *resultArray, int threads)
+{
+    int selectedEngine = engine;
+    const KernelPlan *kernel = (*experiment).kernel;
+    if (selectedEngine == ENGINE_AUTO && precision == PRECISION_DOUBLE &&
+        (*kernel).tapsCount < SPARSE_DENSITY_THRESHOLD * (*kernel).hSize)
+    {
+        selectedEngine = ENGINE_SPARSE;
+    }
+    // the vectorized passes give the same values as the reference ones, for any size of h
+    if (selectedEngine == ENGINE_AUTO)
+    {
+        selectedEngine = ENGINE_SIMD;
+    }
+    // the engines that apply the passes one by one update it when they converge early
+    (*experiment).iterationsRun = (*experiment).n;
+    if ((*experiment).stats != NULL)
+    {
+        (*(*experiment).stats).engine = selectedEngine;
+    }
+    if (precision != PRECISION_DOUBLE)
+    {
+        return reducedConvolutions(experiment, resultArray, threads);
+    }
+    switch (selectedEngine)
+    {
+        case ENGINE_FFT:
+            return fftConvolutions(experiment, resultArray);
+        case ENGINE_POWER:
+            return powerConvolutions(experiment, resultArray);
+        case ENGINE_EXACT:
+            return exactConvolutions(experiment, resultArray);
+        case ENGINE_SPARSE:
+            return sparseConvolutions(experiment, resultArray);
+        case ENGINE_SIMD:
+            return (threads > 1) ? threadedConvolutions(experiment, resultArray, threads) :
+                   simdConvolutions(experiment, resultArray);
+        default:
+            return nConvolutions(experiment, resultArray);
+    }
+}
+
+
+int simdConvolutions(Experiment *experiment, double *resultArray)
+{
+    int windowSize = (*(*experiment).kernel).windowSize;
+    double *temp = (double*) malloc(sizeof(double) * windowSize);
+    if (temp == NULL)
+    {
+        return ALLOCATION_ERROR;
+    }
+    memcpy(temp, (*experiment).g, sizeof(double) * windowSize);
+    for (int i = 0; i < (*experiment).n; ++i)
+    {
+        for (int j = 0; j < windowSize; ++j)
+        {
+            resultArray[j] = directConvolutionAt(temp, (*experiment).kernel, j);
+        }
+        if (hasConverged(resultArray, temp, windowSize))
+        {
+            (*experiment).iterationsRun = i + 1;
+            break;
+        }
+        memcpy(temp, resultArray, sizeof(double) * windowSize);
+    }
+    countMultiplyAdds(experiment, (*experiment).iterationsRun * passMultiplyAdds((*experiment).kernel, 0));
+    free(temp);
+    return CORRECT_INPUT;
+}
+
+int reducedConvolutions(Experiment *experiment, double *resultArray, int threads)
+{
+    const KernelPlan *kernel = (*experiment).kernel;
+    int windowSize = (*kernel).windowSize;
+    int hSize = (*kernel).hSize;
+    ReducedTaps taps = {NULL, NULL};
+    taps.taps = (float*) malloc(sizeof(float) * (hSize > 0 ? hSize : 1));
+    if (precision == PRECISION_MIXED)
+    {
+        taps.wideTaps = (double*) malloc(sizeof(double) * (hSize > 0 ? hSize : 1));
+    }
+    float *temp = (float*) malloc(sizeof(float) * windowSize);
+    float *next = (float*) malloc(sizeof(float) * windowSize);
+    if (taps.taps == NULL || (precision == PRECISION_MIXED && taps.wideTaps == NULL) ||
+        temp == NULL || next == NULL)
+    {
+        free(taps.taps);
+        free(taps.wideTaps);
+        free(temp);
+        free(next);
+        return ALLOCATION_ERROR;
+    }
+    // the widened taps keep the float values, so the mixed products stay exact in double
+    for (int i = 0; i < hSize; ++i)
+    {
+        taps.taps[i] = (float) (*kernel).reversedTaps[i];
+        if (taps.wideTaps != NULL)
+        {
+            taps.wideTaps[i] = taps.taps[i];
+        }
+    }
+    for (int j = 0; j < windowSize; ++j)
+    {
+        temp[j] = (float) (*experiment).g[j];
+    }
+    if (threads > 1)
+    {
+        float *buffers[2] = {temp, next};
+        int passesRun = runPassWorkers(experiment, NULL, buffers, &taps, threads);
+        if (passesRun == ALLOCATION_ERROR)
+        {
+            free(taps.taps);
+            free(taps.wideTaps);
+            free(temp);
+            free(next);
+            return ALLOCATION_ERROR;
+        }
+        (*experiment).iterationsRun = passesRun;
+        temp = buffers[passesRun % 2];
+        next = buffers[(passesRun + 1) % 2];
+    }
+    for (int i = 0; threads <= 1 && i < (*experiment).n; ++i)
+    {
+        double difference = 0;
+        for (int j = 0; j < windowSize; ++j)
+        {
+            next[j] = reducedConvolutionAt(temp, &taps, kernel, j);
+            double change = fabs((double) next[j] - temp[j]);
+            difference = (change > difference) ? change : difference;
+        }
+        float *swap = temp;
+        temp = next;
+        next = swap;
+        if (tolerance > 0 && difference < tolerance)
+        {
+            (*experiment).iterationsRun = i + 1;
+            break;
+        }
+    }
+    for (int j = 0; j < windowSize; ++j)
+    {
+        resultArray[j] = temp[j];
+    }
+    countMultiplyAdds(experiment, (*experiment).iterationsRun * passMultiplyAdds(kernel, 0));
+    free(taps.taps);
+    free(taps.wideTaps);
+    free(temp);
+    free(next);
+    return CORRECT_INPUT;
+}
+
+
+float reducedConvolutionAt(const float *source, const ReducedTaps *taps, const KernelPlan *kernel, int j)
+{
+    // the same range of g indices as directConvolutionAt
+    int base = j + (*kernel).offset - (*kernel).high;
+    int first = (base > 0) ? base : 0;
+    int last = base + (*kernel).hSize - 1;
+    last = (last < (*kernel).windowSize - 1) ? last : (*kernel).windowSize - 1;
+    if (first > last)
+    {
+        return 0;
+    }
+    return (precision == PRECISION_MIXED) ?
+           (float) mixedDotProduct(source + first, (*taps).wideTaps + (first - base), last - first + 1) :
+           singleDotProduct(source + first, (*taps).taps + (first - base), last - first + 1);
+}
+
+
+#ifdef AVX2_DISPATCH
+__attribute__((target("avx2")))
+int avx2SingleDotProductLanes(const float *x, const float *y, int length, float *partialSums)
+{
+    int i = 0;
+    __m256 sums = _mm256_setzero_ps();
+    for (; i + SINGLE_PRODUCT_LANES <= length; i += SINGLE_PRODUCT_LANES)
+    {
+        sums = _mm256_add_ps(sums, _mm256_mul_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+    }
+    _mm256_storeu_ps(partialSums, sums);
+    return i;
+}
+
+
+__attribute__((target("avx2")))
+int avx2MixedDotProductLanes(const float *x, const double *y, int length, double *partialSums)
+{
+    int i = 0;
+    __m256d lowSums = _mm256_setzero_pd();
+    __m256d highSums = _mm256_setzero_pd();
+    for (; i + SINGLE_PRODUCT_LANES <= length; i += SINGLE_PRODUCT_LANES)
+    {
+        __m256 xs = _mm256_loadu_ps(x + i);
+        __m256d low = _mm256_mul_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(xs)), _mm256_loadu_pd(y + i));
+        __m256d high = _mm256_mul_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(xs, 1)),
+                                     _mm256_loadu_pd(y + i + DOT_PRODUCT_LANES));
+        lowSums = _mm256_add_pd(lowSums, low);
+        highSums = _mm256_add_pd(highSums, high);
+    }
+    _mm256_storeu_pd(partialSums, lowSums);
+    _mm256_storeu_pd(partialSums + DOT_PRODUCT_LANES, highSums);
+    return i;
+}
+#endif
+
+
+float singleDotProduct(const float *x, const float *y, int length)
+{
+    float partialSums[SINGLE_PRODUCT_LANES] = {0};
+    int i = 0;
+#ifdef AVX2_DISPATCH
+    if (__builtin_cpu_supports("avx2"))
+    {
+        i = avx2SingleDotProductLanes(x, y, length, partialSums);
+    }
+#endif
+    for (; i + SINGLE_PRODUCT_LANES <= length; i += SINGLE_PRODUCT_LANES)
+    {
+        for (int lane = 0; lane < SINGLE_PRODUCT_LANES; ++lane)
+        {
+            partialSums[lane] = partialSums[lane] + x[i + lane] * y[i + lane];
+        }
+    }
+    for (; i < length; ++i)
+    {
+        partialSums[i % SINGLE_PRODUCT_LANES] = partialSums[i % SINGLE_PRODUCT_LANES] + x[i] * y[i];
+    }
+    return ((partialSums[0] + partialSums[4]) + (partialSums[2] + partialSums[6])) +
+           ((partialSums[1] + partialSums[5]) + (partialSums[3] + partialSums[7]));
+}
+
+
+double mixedDotProduct(const float *x, const double *y, int length)
+{
+    double partialSums[SINGLE_PRODUCT_LANES] = {0};
+    int i = 0;
+#ifdef AVX2_DISPATCH
+    if (__builtin_cpu_supports("avx2"))
+    {
+        i = avx2MixedDotProductLanes(x, y, length, partialSums);
+    }
+#endif
+    // the product of two floats is exact in double, so only the sums round
+    for (; i < length; ++i)
+    {
+        partialSums[i % SINGLE_PRODUCT_LANES] = partialSums[i % SINGLE_PRODUCT_LANES] + x[i] * y[i];
+    }
+    return ((partialSums[0] + partialSums[4]) + (partialSums[2] + partialSums[6])) +
+           ((partialSums[1] + partialSums[5]) + (partialSums[3] + partialSums[7]));
+}
+
+
+int reportDeviation(Experiment *experiment, const double *resultArray, int threads)
+{
+    int windowSize = (*(*experiment).kernel).windowSize;
+    double *reference = (double*) malloc(sizeof(double) * windowSize);
+    if (reference == NULL)
+    {
+        return ALLOCATION_ERROR;
+    }
+    // the double passes stop where the reduced ones did, and are kept out of the stats
+    Experiment doubleExperiment = *experiment;
+    doubleExperiment.n = (*experiment).iterationsRun;
+    doubleExperiment.stats = NULL;
+    int result = (threads > 1) ? threadedConvolutions(&doubleExperiment, reference, threads) :
+                 simdConvolutions(&doubleExperiment, reference);
+    if (result == CORRECT_INPUT)
+    {
+        fprintf(stderr, "Max deviation: %g\n", maxAbsoluteDifference(resultArray, reference, windowSize));
+    }
+    free(reference);
+    return result;
+}
+
+
+int sparseConvolutions(Experiment *experiment, double *resultArray)
+{
+    const KernelPlan *kernel = (*experiment).kernel;
+    int windowSize = (*kernel).windowSize;
+    double *temp = (double*) malloc(sizeof(double) * windowSize);
+    if (temp == NULL)
+    {
+        return ALLOCATION_ERROR;
+    }
+    memcpy(temp, (*experiment).g, sizeof(double) * windowSize);
+    long long multiplyAdds = 0;
+    for (int i = 0; i < (*experiment).n; ++i)
+    {
+        memset(resultArray, 0, sizeof(double) * windowSize);
+        for (int k = 0; k < windowSize; ++k)
+        {
+            if (temp[k] == 0)
+            {
+                continue;
+            }
+            for (int tap = 0; tap < (*kernel).tapsCount; ++tap)
+            {
+                int j = k + (*kernel).tapShifts[tap];
+                if (j >= 0 && j < windowSize)
+                {
+                    resultArray[j] = resultArray[j] + temp[k] * (*kernel).tapWeights[tap];
+                    ++multiplyAdds;
+                }
+            }
+        }
+        if (hasConverged(resultArray, temp, windowSize))
+        {
+            (*experiment).iterationsRun = i + 1;
+            break;
+        }
+        memcpy(temp, resultArray, sizeof(double) * windowSize);
+    }
+    countMultiplyAdds(experiment, multiplyAdds);
+    free(temp);
+    return CORRECT_INPUT;
+}
+
+
+int threadedConvolutions(Experiment *experiment, double *resultArray, int threads)
+{
+    int windowSize = (*(*experiment).kernel).windowSize;
+    double *temp = (double*) malloc(sizeof(double) * windowSize);
+    if (temp == NULL)
+    {
+        return ALLOCATION_ERROR;
+    }
+    memcpy(temp, (*experiment).g, sizeof(double) * windowSize);
+    double *buffers[2] = {temp, resultArray};
+    int passesRun = runPassWorkers(experiment, buffers, NULL, NULL, threads);
+    if (passesRun == ALLOCATION_ERROR)
+    {
+        free(temp);
+        return ALLOCATION_ERROR;
+    }
+    (*experiment).iterationsRun = passesRun;
+    countMultiplyAdds(experiment, (*experiment).iterationsRun * passMultiplyAdds((*experiment).kernel, 0));
+    if ((*experiment).iterationsRun % 2 == 0)
+    {
+        memcpy(resultArray, temp, sizeof(double) * windowSize);
+    }
+    free(temp);
+    return CORRECT_INPUT;
+}
+
+
+int runPassWorkers(const Experiment *experiment, double **buffers, float **reducedBuffers,
+                   const ReducedTaps *taps, int threads)
+{
+    int windowSize = (*(*experiment).kernel).windowSize;
+    int workersCount = (threads < windowSize) ? threads : windowSize;
+    pthread_t *workerThreads = (pthread_t*) malloc(sizeof(pthread_t) * workersCount);
+    PassWorker *workers = (PassWorker*) malloc(sizeof(PassWorker) * workersCount);
+    double *changes = (double*) malloc(sizeof(double) * 2 * workersCount);
+    if (workerThreads == NULL || workers == NULL || changes == NULL)
+    {
+        free(workerThreads);
+        free(workers);
+        free(changes);
+        return ALLOCATION_ERROR;
+    }
+    pthread_barrier_t barrier;
+    pthread_mutex_t startLock = PTHREAD_MUTEX_INITIALIZER;
+    for (int i = 0; i < workersCount; ++i)
+    {
+        workers[i].experiment = experiment;
+        workers[i].buffers = buffers;
+        workers[i].reducedBuffers = reducedBuffers;
+        workers[i].taps = taps;
+        workers[i].barrier = &barrier;
+        workers[i].startLock = &startLock;
+        workers[i].changes = changes;
+        workers[i].index = i;
+        workers[i].count = workersCount;
+        workers[i].first = (int) ((long) windowSize * i / workersCount);
+        workers[i].last = (int) ((long) windowSize * (i + 1) / workersCount);
+    }
+    pthread_mutex_lock(&startLock);
+    int started = 0;
+    while (started < workersCount - 1 &&
+           pthread_create(&workerThreads[started], NULL, passWorker, &workers[started]) == 0)
+    {
+        ++started;
+    }
+    // the calling thread runs the indices of every worker that could not be started
+    PassWorker *callingWorker = &workers[started];
+    (*callingWorker).last = windowSize;
+    for (int i = 0; i <= started; ++i)
+    {
+        workers[i].count = started + 1;
+    }
+    pthread_barrier_init(&barrier, NULL, started + 1);
+    pthread_mutex_unlock(&startLock);
+    passWorker(callingWorker);
+    for (int i = 0; i < started; ++i)
+    {
+        pthread_join(workerThreads[i], NULL);
+    }
+    pthread_barrier_destroy(&barrier);
+    pthread_mutex_destroy(&startLock);
+    int passesRun = (*callingWorker).passesRun;
+    free(workerThreads);
+    free(workers);
+    free(changes);
+    return passesRun;
+}
+
+
+void *passWorker(void *argument)
+{
+    PassWorker *worker = (PassWorker*) argument;
+    pthread_mutex_lock((*worker).startLock);
+    pthread_mutex_unlock((*worker).startLock);
+    const Experiment *experiment = (*worker).experiment;
+    (*worker).passesRun = 0;
+    for (int i = 0; i < (*experiment).n; ++i)
+    {
+        double workerChange = 0;
+        if ((*worker).reducedBuffers != NULL)
+        {
+            const float *source = (*worker).reducedBuffers[i % 2];
+            float *destination = (*worker).reducedBuffers[(i + 1) % 2];
+            for (int j = (*worker).first; j < (*worker).last; ++j)
+            {
+                destination[j] = reducedConvolutionAt(source, (*worker).taps, (*experiment).kernel, j);
+                double change = fabs((double) destination[j] - source[j]);
+                workerChange = (change > workerChange) ? change : workerChange;
+            }
+        }
+        else
+        {
+            const double *source = (*worker).buffers[i % 2];
+            double *destination = (*worker).buffers[(i + 1) % 2];
+            for (int j = (*worker).first; j < (*worker).last; ++j)
+            {
+                destination[j] = directConvolutionAt(source, (*experiment).kernel, j);
+            }
+            if (tolerance > 0)
+            {
+                workerChange = maxAbsoluteDifference(destination + (*worker).first, source + (*worker).first,
+                                                     (*worker).last - (*worker).first);
+            }
+        }
+        // the slots alternate by pass parity, so a fast thread never overwrites a slot being read
+        double *changes = (*worker).changes + (i % 2) * (*worker).count;
+        if (tolerance > 0)
+        {
+            changes[(*worker).index] = workerChange;
+        }
+        // no thread writes the next pass over the source before all of them finished reading it
+        pthread_barrier_wait((*worker).barrier);
+        (*worker).passesRun = i + 1;
+        if (tolerance > 0)
+        {
+            double change = 0;
+            for (int k = 0; k < (*worker).count; ++k)
+            {
+                change = (changes[k] > change) ? changes[k] : change;
+            }
+            if (change < tolerance)
+            {
+                break;
+            }
+        }
+    }
+    return NULL;
+}
+
+
+int hasConverged(const double *current, const double *previous, int arraySize)
+{
+    return (tolerance > 0) && (maxAbsoluteDifference(current, previous, arraySize) < tolerance);
+}
+
+int createKernelPlan(KernelPlan *kernel, const double *hSamples, int hSize, int windowSize)
+{
+    (*kernel).hSize = hSize;
+    (*kernel).scale = 1;
+    (*kernel).windowSize = windowSize;
+    (*kernel).offset = 2 * (windowSize / 2) - (windowSize + 1) / 2 - 1;
+    (*kernel).high = centerStart(hSize, windowSize) + hSize - 1;
+    (*kernel).h = (double*) calloc(windowSize, sizeof(double));
+    (*kernel).reversedTaps = (double*) malloc(sizeof(double) * (hSize > 0 ? hSize : 1));
+    (*kernel).tapShifts = (int*) malloc(sizeof(int) * (hSize > 0 ? hSize : 1));
+    (*kernel).tapWeights = (double*) malloc(sizeof(double) * (hSize > 0 ? hSize : 1));
+    (*kernel).tapsCount = 0;
+    (*kernel).spectra = NULL;
+    (*kernel).spectraCount = 0;
+    if ((*kernel).h == NULL || (*kernel).reversedTaps == NULL || (*kernel).tapShifts == NULL ||
+        (*kernel).tapWeights == NULL)
+    {
+        return ALLOCATION_ERROR;
+    }
+    memcpy((*kernel).h, hSamples, sizeof(double) * hSize);
+    centerArray((*kernel).h, hSize, windowSize);
+    for (int i = 0; i < hSize; ++i)
+    {
+        (*kernel).reversedTaps[i] = (*kernel).h[(*kernel).high - i];
+    }
+    // g[k] meets h[c] at the output index j = k + c - offset
+    for (int c = centerStart(hSize, windowSize); c <= (*kernel).high; ++c)
+    {
+        if ((*kernel).h[c] != 0)
+        {
+            (*kernel).tapShifts[(*kernel).tapsCount] = c - (*kernel).offset;
+            (*kernel).tapWeights[(*kernel).tapsCount] = (*kernel).h[c];
+            ++(*kernel).tapsCount;
+        }
+    }
+    return CORRECT_INPUT;
+}
+
+
+void freeKernelPlan(KernelPlan *kernel)
+{
+    free((*kernel).h);
+    free((*kernel).reversedTaps);
+    free((*kernel).tapShifts);
+    free((*kernel).tapWeights);
+    for (int i = 0; i < (*kernel).spectraCount; ++i)
+    {
+        free((*kernel).spectra[i].values);
+    }
+    free((*kernel).spectra);
+    (*kernel).h = NULL;
+    (*kernel).reversedTaps = NULL;
+    (*kernel).tapShifts = NULL;
+    (*kernel).tapWeights = NULL;
+    (*kernel).spectra = NULL;
+    (*kernel).spectraCount = 0;
+    return;
+}
+
+double directConvolutionAt(const double *source, const KernelPlan *kernel, int j)
+{
+    // g[k] meets h[j + offset - k], which is non zero for k in [j + offset - high, j + offset - high + hSize)
+    return convolutionAt(source, (*kernel).windowSize, (*kernel).reversedTaps, (*kernel).hSize,
+                         (*kernel).offset - (*kernel).high, j);
+}
+
+int powerConvolutions(Experiment *experiment, double *resultArray)
+{
+    const KernelPlan *kernel = (*experiment).kernel;
+    int windowSize = (*kernel).windowSize;
+    long matrixSize = (long) windowSize * windowSize;
+    double *power = (double*) calloc(matrixSize, sizeof(double));
+    double *square = (double*) malloc(sizeof(double) * matrixSize);
+    double *temp = (double*) malloc(sizeof(double) * windowSize);
+    if (power == NULL || square == NULL || temp == NULL)
+    {
+        free(power);
+        free(square);
+        free(temp);
+        return ALLOCATION_ERROR;
+    }
+    // row j holds the weights of g in output j, the same range directConvolutionAt sums
+    for (int j = 0; j < windowSize; ++j)
+    {
+        int base = j + (*kernel).offset - (*kernel).high;
+        for (int i = 0; i < (*kernel).hSize; ++i)
+        {
+            if (base + i >= 0 && base + i < windowSize)
+            {
+                power[(long) j * windowSize + base + i] = (*kernel).reversedTaps[i];
+            }
+        }
+    }
+    memcpy(resultArray, (*experiment).g, sizeof(double) * windowSize);
+    int exponent = (*experiment).n;
+    while (exponent > 0)
+    {
+        if (exponent % 2 != 0)
+        {
+            multiplyMatrixByVector(power, resultArray, temp, windowSize);
+            memcpy(resultArray, temp, sizeof(double) * windowSize);
+        }
+        exponent = exponent / 2;
+        if (exponent > 0)
+        {
+            multiplyMatrices(power, power, square, windowSize);
+            double *swap = power;
+            power = square;
+            square = swap;
+        }
+    }
+    // complexPower squares once per bit of n and multiplies once per set bit, and so does this
+    int squarings = 0;
+    int products = 0;
+    for (int bits = (*experiment).n; bits > 1; bits = bits / 2)
+    {
+        ++squarings;
+    }
+    products = powerMultiplications((*experiment).n) - squarings - 1;
+    countMultiplyAdds(experiment, (long long) windowSize * windowSize * (windowSize * (long long) squarings + products));
+    free(power);
+    free(square);
+    free(temp);
+    return CORRECT_INPUT;
+}
+
+
+void multiplyMatrices(const double *left, const double *right, double *product, int size)
+{
+    memset(product, 0, sizeof(double) * size * size);
+    for (int i = 0; i < size; ++i)
+    {
+        double *productRow = product + (long) i * size;
+        for (int k = 0; k < size; ++k)
+        {
+            double weight = left[(long) i * size + k];
+            if (weight == 0)
+            {
+                continue;
+            }
+            const double *rightRow = right + (long) k * size;
+            for (int j = 0; j < size; ++j)
+            {
+                productRow[j] = productRow[j] + weight * rightRow[j];
+            }
+        }
+    }
+    return;
+}
+
+
+void multiplyMatrixByVector(const double *matrix, const double *vector, double *product, int size)
+{
+    for (int i = 0; i < size; ++i)
+    {
+        product[i] = dotProduct(matrix + (long) i * size, vector, size);
+    }
+    return;
+}
+
+
+int fftConvolutions(Experiment *experiment, double *resultArray)
+{
+    const KernelPlan *kernel = (*experiment).kernel;
+    int windowSize = (*kernel).windowSize;
+    int n = (*experiment).n;
+    long transformSize = transformSizeFor(kernel, n);
+    const double complex *spectrum = findKernelSpectrum(kernel, transformSize, n);
+    long long kernelMultiplyAdds = 0;
+    double complex *gTransform = (double complex*) calloc(transformSize, sizeof(double complex));
+    double complex *hTransform = NULL;
+    if (spectrum == NULL)
+    {
+        hTransform = (double complex*) calloc(transformSize, sizeof(double complex));
+    }
+    if (gTransform == NULL || (spectrum == NULL && hTransform == NULL))
+    {
+        free(gTransform);
+        free(hTransform);
+        return ALLOCATION_ERROR;
+    }
+    if (spectrum == NULL)
+    {
+        transformKernel(kernel, transformSize, n, hTransform);
+        spectrum = hTransform;
+        kernelMultiplyAdds = transformButterflies(transformSize) + transformSize * (long long) powerMultiplications(n);
+    }
+    for (int i = 0; i < windowSize; ++i)
+    {
+        gTransform[i] = (*experiment).g[i];
+    }
+    fft(gTransform, transformSize, 0);
+    for (long i = 0; i < transformSize; ++i)
+    {
+        gTransform[i] = gTransform[i] * spectrum[i];
+    }
+    fft(gTransform, transformSize, 1);
+    for (int j = 0; j < windowSize; ++j)
+    {
+        // the samples are non negative, so a negative value is only rounding noise of the transform
+        double value = creal(gTransform[j]);
+        resultArray[j] = (value > 0) ? value : 0;
+    }
+    countMultiplyAdds(experiment, 4 * (2 * transformButterflies(transformSize) + transformSize + kernelMultiplyAdds));
+    free(gTransform);
+    free(hTransform);
+    return CORRECT_INPUT;
+}
+
+
+void transformKernel(const KernelPlan *kernel, long transformSize, int n, double complex *spectrum)
+{
+    int hSize = (*kernel).hSize;
+    int windowSize = (*kernel).windowSize;
+    int kernelStart = centerStart(hSize, windowSize) - (*kernel).offset;
+    for (int i = 0; i < hSize; ++i)
+    {
+        long index = ((kernelStart + i) % transformSize + transformSize) % transformSize;
+        spectrum[index] = (*kernel).h[centerStart(hSize, windowSize) + i];
+    }
+    fft(spectrum, transformSize, 0);
+    for (long i = 0; i < transformSize; ++i)
+    {
+        spectrum[i] = complexPower(spectrum[i], n);
+    }
+    return;
+}
+
+
+const double complex *findKernelSpectrum(const KernelPlan *kernel, long transformSize, int n)
+{
+    for (int i = 0; i < (*kernel).spectraCount; ++i)
+    {
+        if ((*kernel).spectra[i].transformSize == transformSize && (*kernel).spectra[i].n == n)
+        {
+            return (*kernel).spectra[i].values;
+        }
+    }
+    return NULL;
+}
+
+
+int cacheKernelSpectrum(KernelPlan *kernel, int n)
+{
+    long transformSize = transformSizeFor(kernel, n);
+    if (findKernelSpectrum(kernel, transformSize, n) != NULL)
+    {
+        return CORRECT_INPUT;
+    }
+    KernelSpectrum *grown = (KernelSpectrum*) realloc((*kernel).spectra,
+                                                      sizeof(KernelSpectrum) * ((*kernel).spectraCount + 1));
+    if (grown == NULL)
+    {
+        return ALLOCATION_ERROR;
+    }
+    (*kernel).spectra = grown;
+    double complex *values = (double complex*) calloc(transformSize, sizeof(double complex));
+    if (values == NULL)
+    {
+        return ALLOCATION_ERROR;
+    }
+    transformKernel(kernel, transformSize, n, values);
+    (*kernel).spectra[(*kernel).spectraCount].transformSize = transformSize;
+    (*kernel).spectra[(*kernel).spectraCount].n = n;
+    (*kernel).spectra[(*kernel).spectraCount].values = values;
+    ++(*kernel).spectraCount;
+    return CORRECT_INPUT;
+}
+
+
+int fullConvolutions(Experiment *experiment, double **resultArray, int *resultSize)
+{
+    const KernelPlan *kernel = (*experiment).kernel;
+    int gSize = (*experiment).gSize;
+    int hSize = (*kernel).hSize;
+    long length = gSize + (long) (*experiment).n * (hSize > 0 ? hSize - 1 : 0);
+    if (length > INT_MAX)
+    {
+        return INPUT_ERROR;
+    }
+    *resultSize = (int) length;
+    if ((*experiment).stats != NULL)
+    {
+        (*(*experiment).stats).engine = (engine == ENGINE_FFT) ? ENGINE_FFT : ENGINE_DIRECT;
+    }
+    if (engine == ENGINE_FFT || hSize == 0)
+    {
+        *resultArray = (double*) calloc(length > 0 ? length : 1, sizeof(double));
+        if (*resultArray == NULL)
+        {
+            return ALLOCATION_ERROR;
+        }
+        return (hSize == 0) ? CORRECT_INPUT : fullFftConvolutions(experiment, *resultArray, (int) length);
+    }
+    double *current = NULL;
+    double *next = NULL;
+    int capacity = 0;
+    if (growPassBuffers(&current, &next, &capacity, gSize) == ALLOCATION_ERROR)
+    {
+        free(current);
+        free(next);
+        return ALLOCATION_ERROR;
+    }
+    memcpy(current, (*experiment).g + centerStart(gSize, (*kernel).windowSize), sizeof(double) * gSize);
+    int size = gSize;
+    for (int i = 0; i < (*experiment).n; ++i)
+    {
+        if (growPassBuffers(&current, &next, &capacity, size + hSize - 1) == ALLOCATION_ERROR)
+        {
+            free(current);
+            free(next);
+            return ALLOCATION_ERROR;
+        }
+        for (int j = 0; j < size + hSize - 1; ++j)
+        {
+            // current[k] meets h[j - k], which is a sample of h for k in [j - hSize + 1, j]
+            int base = j - hSize + 1;
+            int first = (base > 0) ? base : 0;
+            int last = (j < size - 1) ? j : size - 1;
+            next[j] = dotProduct(current + first, (*kernel).reversedTaps + (first - base), last - first + 1);
+        }
+        countMultiplyAdds(experiment, (long long) size * hSize);
+        double *swap = current;
+        current = next;
+        next = swap;
+        size = size + hSize - 1;
+    }
+    free(next);
+    *resultArray = current;
+    return CORRECT_INPUT;
+}
+
+
+int fullFftConvolutions(Experiment *experiment, double *resultArray, int resultSize)
+{
+    const KernelPlan *kernel = (*experiment).kernel;
+    int gSize = (*experiment).gSize;
+    int hSize = (*kernel).hSize;
+    // the transform is sized for the final length, so no index of the result wraps
+    long transformSize = nextPowerOfTwo(resultSize);
+    double complex *gTransform = (double complex*) calloc(transformSize, sizeof(double complex));
+    double complex *hTransform = (double complex*) calloc(transformSize, sizeof(double complex));
+    if (gTransform == NULL || hTransform == NULL)
+    {
+        free(gTransform);
+        free(hTransform);
+        return ALLOCATION_ERROR;
+    }
+    const double *g = (*experiment).g + centerStart(gSize, (*kernel).windowSize);
+    const double *h = (*kernel).h + centerStart(hSize, (*kernel).windowSize);
+    for (int i = 0; i < gSize; ++i)
+    {
+        gTransform[i] = g[i];
+    }
+    for (int i = 0; i < hSize; ++i)
+    {
+        hTransform[i] = h[i];
+    }
+    fft(gTransform, transformSize, 0);
+    fft(hTransform, transformSize, 0);
+    for (long i = 0; i < transformSize; ++i)
+    {
+        gTransform[i] = gTransform[i] * complexPower(hTransform[i], (*experiment).n);
+    }
+    fft(gTransform, transformSize, 1);
+    for (int j = 0; j < resultSize; ++j)
+    {
+        double value = creal(gTransform[j]);
+        resultArray[j] = (value > 0) ? value : 0;
+    }
+    countMultiplyAdds(experiment, 4 * (3 * transformButterflies(transformSize) +
+                                       transformSize * (long long) (powerMultiplications((*experiment).n) + 1)));
+    free(gTransform);
+    free(hTransform);
+    return CORRECT_INPUT;
+}
 
-/**
- * @brief Applies the convolution n times
- * @param resultArray the array that will contain the result of the convultion
- * @param n the number of times to apply the convolution.
- */
-void nConvolutions(double *resultArray);
 
-/**
- * @brief Applies a convolution
- * @param t The index for the convolution
- * @return The result of the convolution
- */
-double singleConvolution(double array[], int t);
+int growPassBuffers(double **current, double **next, int *capacity, int size)
+{
+    if (size <= *capacity)
+    {
+        return CORRECT_INPUT;
+    }
+    long grown = (*capacity > 0) ? *capacity : INITIAL_BUFFER_CAPACITY;
+    while (grown < size)
+    {
+        grown = grown * 2;
+    }
+    grown = (grown < INT_MAX) ? grown : INT_MAX;
+    double *currentGrown = (double*) realloc(*current, sizeof(double) * grown);
+    if (currentGrown == NULL)
+    {
+        return ALLOCATION_ERROR;
+    }
+    *current = currentGrown;
+    double *nextGrown = (double*) realloc(*next, sizeof(double) * grown);
+    if (nextGrown == NULL)
+    {
+        return ALLOCATION_ERROR;
+    }
+    *next = nextGrown;
+    *capacity = (int) grown;
+    return CORRECT_INPUT;
+}
 
-/**
- * @brief checks the validity of parameterized bounds
- * @param t The parameterized index for the convultion
- * @param m The actual index after the parameterization.
- * @return 1 if the bounds are valid or false otherwise.
- */
-int checkBoundsForSingleConvolution(int t, int m);
 
-/**
- * @brief Normalizes the given array
- * @param array The array to normalize
- * @param arraySize The size of the array
- */
-void normalizeArray(double array[], int arraySize);
+void fft(double complex *data, long size, int inverse)
+{
+    for (long i = 1, j = 0; i < size; ++i)
+    {
+        long bit = size >> 1;
+        while (j & bit)
+        {
+            j ^= bit;
+            bit >>= 1;
+        }
+        j ^= bit;
+        if (i < j)
+        {
+            double complex swap = data[i];
+            data[i] = data[j];
+            data[j] = swap;
+        }
+    }
+    for (long length = 2; length <= size; length <<= 1)
+    {
+        double angle = (inverse ? 2 : -2) * M_PI / length;
+        double complex rootOfUnity = cexp(I * angle);
+        for (long start = 0; start < size; start += length)
+        {
+            double complex twiddle = 1;
+            for (long k = 0; k < length / 2; ++k)
+            {
+                double complex even = data[start + k];
+                double complex odd = data[start + k + length / 2] * twiddle;
+                data[start + k] = even + odd;
+                data[start + k + length / 2] = even - odd;
+                twiddle = twiddle * rootOfUnity;
+            }
+        }
+    }
+    if (inverse)
+    {
+        for (long i = 0; i < size; ++i)
+        {
+            data[i] = data[i] / size;
+        }
+    }
+    return;
+}
 
-/**
- * @brief Normalizes and centers g and h arrays.
- */
-void prepareInputForConvolution();
 
-/**
- * @brief Centers the given array
- * @param array the array to center
- * @param arraySize the size of the array
- */
-void centerArray(double array[], int arraySize);
+double complex complexPower(double complex base, int exponent)
+{
+    double complex result = 1;
+    while (exponent > 0)
+    {
+        if (exponent % 2 != 0)
+        {
+            result = result * base;
+        }
+        base = base * base;
+        exponent = exponent / 2;
+    }
+    return result;
+}
 
-/**
- * @brief Find the location of the decimal point.
- * @param charArray charArray that represents a double number
- * @return The location of the decimal point. If there is no decimal point this function will
- * returns the length of the "number", and if there is more than 1 decimal point,
- * this function will return an input error.
- */
-int findDecimalPointPosition(char *charArray);
 
-/**
- * @brief finds the arrays length.
- * @param inputArray The input Array
- * @return The length of the given input Array.
- */
-int getInputArrayLength(char* inputArray);
+long nextPowerOfTwo(long size)
+{
+    long power = 1;
+    while (power < size)
+    {
+        power <<= 1;
+    }
+    return power;
+}
 
-/**
- * @brief Converts a char array to a double array.
- * @param arrayToConvert The array to Convert.
- * @return the valid double, or if it is not one - an input error
- */
-int convertInputToDoubleArray(char arrayToConvert[], double convertedArray[]);
 
+long transformSizeFor(const KernelPlan *kernel, int n)
+{
+    int windowSize = (*kernel).windowSize;
+    int hSize = (*kernel).hSize;
+    long kernelStart = centerStart(hSize, windowSize) - (*kernel).offset;
+    // every pass moves the support by kernelStart at the low end and kernelStart + hSize - 1 at the high end
+    long low = (n * kernelStart < 0) ? n * kernelStart : 0;
+    long high = windowSize + ((hSize > 0 && kernelStart + hSize - 1 > 0) ? n * (kernelStart + hSize - 1) : 0);
+    return nextPowerOfTwo(high - low);
+}
 
-/**
- * @brief Converts a char array to a non positive double
- * @param array The char array to be converted
- * @return returns the double If the char array represents a valid double, otherwise,
- * returns input error.
- */
-double extractDoubleFromString(char *array);
 
+int exactConvolutions(Experiment *experiment, double *resultArray)
+{
+    const KernelPlan *kernel = (*experiment).kernel;
+    int windowSize = (*kernel).windowSize;
+    int hSize = (*kernel).hSize;
+    int n = (*experiment).n;
+    long transformSize = transformSizeFor(kernel, n);
+    uint64_t *gCounts = (uint64_t*) malloc(sizeof(uint64_t) * windowSize);
+    uint64_t *hCounts = (uint64_t*) malloc(sizeof(uint64_t) * (hSize > 0 ? hSize : 1));
+    uint64_t *residues = (uint64_t*) malloc(sizeof(uint64_t) * NTT_PRIMES_COUNT * windowSize);
+    if (gCounts == NULL || hCounts == NULL || residues == NULL)
+    {
+        free(gCounts);
+        free(hCounts);
+        free(residues);
+        return ALLOCATION_ERROR;
+    }
+    double gSum = 0;
+    double hSum = 0;
+    int result = CORRECT_INPUT;
+    if (restoreCounts((*experiment).g, windowSize, (*experiment).scale, gCounts, &gSum) == INPUT_ERROR ||
+        restoreCounts((*kernel).h + centerStart(hSize, windowSize), hSize, (*kernel).scale, hCounts,
+                      &hSum) == INPUT_ERROR)
+    {
+        result = INPUT_ERROR;
+    }
+    // every count of the result is at most sum(g) * sum(h)^n, so that many bits must be reconstructed
+    double bits = log2(gSum) + n * log2(hSum);
+    double capacity = 0;
+    int primesCount = 0;
+    while (primesCount < NTT_PRIMES_COUNT && capacity <= bits + 1)
+    {
+        capacity = capacity + log2((double) nttPrimes[primesCount]);
+        ++primesCount;
+    }
+    if (capacity <= bits + 1)
+    {
+        result = INPUT_ERROR;
+    }
+    for (int q = 0; q < primesCount && result == CORRECT_INPUT; ++q)
+    {
+        if ((nttPrimes[q] - 1) % transformSize != 0)
+        {
+            result = INPUT_ERROR;
+            break;
+        }
+        result = residueConvolutions(gCounts, hCounts, experiment, transformSize, q, residues + (long) q * windowSize);
+        countMultiplyAdds(experiment, 3 * transformButterflies(transformSize) +
+                                      transformSize * (long long) (powerMultiplications(n) + 1));
+    }
+    if (result == CORRECT_INPUT)
+    {
+        uint64_t inverses[NTT_PRIMES_COUNT][NTT_PRIMES_COUNT];
+        for (int m = 0; m < primesCount; ++m)
+        {
+            for (int q = m + 1; q < primesCount; ++q)
+            {
+                inverses[m][q] = modularPower(nttPrimes[m] % nttPrimes[q], nttPrimes[q] - 2, nttPrimes[q]);
+            }
+        }
+        // sum(g) * sum(h)^n is at most the product of the primes, so it is built exactly as well
+        ExactCount denominator;
+        ExactCount hTotal;
+        ExactCount term;
+        ExactCount product;
+        setExactCount(&denominator, 0);
+        setExactCount(&hTotal, 0);
+        for (int i = 0; i < windowSize; ++i)
+        {
+            setExactCount(&term, gCounts[i]);
+            addExactCounts(&denominator, &term);
+        }
+        for (int i = 0; i < hSize; ++i)
+        {
+            setExactCount(&term, hCounts[i]);
+            addExactCounts(&hTotal, &term);
+        }
+        for (int i = 0; i < n && hSum > 1; ++i)
+        {
+            multiplyExactCounts(&denominator, &hTotal, &product);
+            denominator = product;
+        }
+        for (int j = 0; j < windowSize; ++j)
+        {
+            // the count is digits[0] + digits[1] p0 + digits[2] p0 p1 + ..., with digits[q] < pq
+            uint64_t digits[NTT_PRIMES_COUNT];
+            for (int q = 0; q < primesCount; ++q)
+            {
+                uint64_t prime = nttPrimes[q];
+                uint64_t digit = residues[(long) q * windowSize + j];
+                for (int m = 0; m < q; ++m)
+                {
+                    digit = (digit + prime - digits[m] % prime) % prime * inverses[m][q] % prime;
+                }
+                digits[q] = digit;
+            }
+            ExactCount count;
+            setExactCount(&count, 0);
+            for (int q = primesCount - 1; q >= 0; --q)
+            {
+                multiplyAddExactCount(&count, (uint32_t) nttPrimes[q], (uint32_t) digits[q]);
+            }
+            resultArray[j] = divideExactCounts(&count, &denominator);
+        }
+    }
+    free(gCounts);
+    free(hCounts);
+    free(residues);
+    return result;
+}
 
 
-/**
- * @brief The main method.
- */
-int main()
+int residueConvolutions(const uint64_t *gCounts, const uint64_t *hCounts, const Experiment *experiment,
+                        long transformSize, int prime, uint64_t *residues)
 {
-    if(parseInput() == INPUT_ERROR)
+    const KernelPlan *kernel = (*experiment).kernel;
+    int windowSize = (*kernel).windowSize;
+    int hSize = (*kernel).hSize;
+    int kernelStart = centerStart(hSize, windowSize) - (*kernel).offset;
+    uint64_t modulus = nttPrimes[prime];
+    uint64_t *gTransform = (uint64_t*) calloc(transformSize, sizeof(uint64_t));
+    uint64_t *hTransform = (uint64_t*) calloc(transformSize, sizeof(uint64_t));
+    if (gTransform == NULL || hTransform == NULL)
     {
-        fprintf(stderr, "ERROR\n");
-        return EXIT_FAILURE;
+        free(gTransform);
+        free(hTransform);
+        return ALLOCATION_ERROR;
     }
-    prepareInputForConvolution();
-    if(n > MINIMUM_ITERATIONS)
+    for (int i = 0; i < windowSize; ++i)
     {
-        double resultArray[SAMPLES_UPPER_BOUND];
-        nConvolutions(resultArray);
-        histogram(resultArray, SAMPLES_UPPER_BOUND);
+        gTransform[i] = gCounts[i] % modulus;
     }
-    else
+    for (int i = 0; i < hSize; ++i)
     {
-        histogram(gArray, SAMPLES_UPPER_BOUND);
+        long index = ((kernelStart + i) % transformSize + transformSize) % transformSize;
+        hTransform[index] = hCounts[i] % modulus;
     }
-    printf("\n");
-    return SUCCESSFUL_EXIT_CODE;
+    ntt(gTransform, transformSize, 0, modulus, nttRoots[prime]);
+    ntt(hTransform, transformSize, 0, modulus, nttRoots[prime]);
+    for (long i = 0; i < transformSize; ++i)
+    {
+        gTransform[i] = gTransform[i] * modularPower(hTransform[i], (*experiment).n, modulus) % modulus;
+    }
+    ntt(gTransform, transformSize, 1, modulus, nttRoots[prime]);
+    memcpy(residues, gTransform, sizeof(uint64_t) * windowSize);
+    free(gTransform);
+    free(hTransform);
+    return CORRECT_INPUT;
 }
 
 
-int parseInput()
+int restoreCounts(const double *samples, int size, double scale, uint64_t *counts, double *sum)
 {
-    char gInput[MAX_LINE_LENGTH];
-    char hInput[MAX_LINE_LENGTH];
-    char nInput[MAX_LINE_LENGTH];
-    if ((fgets(gInput, MAX_LINE_LENGTH, stdin) == NULL) ||
-        (fgets(hInput, MAX_LINE_LENGTH, stdin) == NULL) ||
-        (fgets(nInput, MAX_LINE_LENGTH, stdin) == NULL))
+    *sum = 0;
+    for (int i = 0; i < size; ++i)
     {
-        return INPUT_ERROR;
+        double raw = samples[i] * scale;
+        double count = round(raw);
+        if (fabs(raw - count) > INTEGER_TOLERANCE * (count + 1) || count >= MAXIMAL_EXACT_COUNT)
+        {
+            return INPUT_ERROR;
+        }
+        counts[i] = (uint64_t) count;
+        *sum = *sum + count;
+    }
+    return CORRECT_INPUT;
+}
+
+
+void ntt(uint64_t *data, long size, int inverse, uint64_t prime, uint64_t root)
+{
+    for (long i = 1, j = 0; i < size; ++i)
+    {
+        long bit = size >> 1;
+        while (j & bit)
+        {
+            j ^= bit;
+            bit >>= 1;
+        }
+        j ^= bit;
+        if (i < j)
+        {
+            uint64_t swap = data[i];
+            data[i] = data[j];
+            data[j] = swap;
+        }
     }
-    gSize = getInputArrayLength(gInput);
-    hSize = getInputArrayLength(hInput);
-    if((gSize > SAMPLES_UPPER_BOUND) || (hSize > gSize) ||
-       (convertInputToDoubleArray(gInput, gArray) == INPUT_ERROR) ||
-       (convertInputToDoubleArray(hInput, hArray) == INPUT_ERROR))
+    for (long length = 2; length <= size; length <<= 1)
     {
-        return INPUT_ERROR;
+        uint64_t rootOfUnity = modularPower(root, (prime - 1) / length, prime);
+        if (inverse)
+        {
+            rootOfUnity = modularPower(rootOfUnity, prime - 2, prime);
+        }
+        for (long start = 0; start < size; start += length)
+        {
+            uint64_t twiddle = 1;
+            for (long k = 0; k < length / 2; ++k)
+            {
+                uint64_t even = data[start + k];
+                uint64_t odd = data[start + k + length / 2] * twiddle % prime;
+                data[start + k] = (even + odd) % prime;
+                data[start + k + length / 2] = (even + prime - odd) % prime;
+                twiddle = twiddle * rootOfUnity % prime;
+            }
+        }
     }
-    strtok(nInput, "\n");
-    if (findDecimalPointPosition(nInput) != strlen(nInput))
+    if (inverse)
     {
-        return INPUT_ERROR;
+        uint64_t sizeInverse = modularPower(size % prime, prime - 2, prime);
+        for (long i = 0; i < size; ++i)
+        {
+            data[i] = data[i] * sizeInverse % prime;
+        }
     }
-    n = (int) extractDoubleFromString(nInput);
-    return CORRECT_INPUT;
+    return;
 }
 
 
-void histogram(double array[], int arraySize)
+uint64_t modularPower(uint64_t base, uint64_t exponent, uint64_t modulus)
 {
-    if(array[indexOfMaxValue(array, arraySize)] <= EPSILON)
+    uint64_t result = 1 % modulus;
+    while (exponent > 0)
     {
-        return;
+        if (exponent % 2 != 0)
+        {
+            result = result * base % modulus;
+        }
+        base = base * base % modulus;
+        exponent = exponent / 2;
     }
-    roundBeforeHistogram(array, arraySize);
-	for (int i = 0; i < arraySize; ++i)
-	{
-		printf("%0.3f: ", array[i]);
-        printAsterisks(floor(( array[i] / array[indexOfMaxValue(array, arraySize)] ) * 20));
-		printf("\n");
-	}
-	return;
+    return result;
 }
 
 
-void printAsterisks(int n)
+void setExactCount(ExactCount *count, uint64_t value)
 {
-    int i = 0;
-    while(i<n)
+    for (int i = 0; i < EXACT_COUNT_LIMBS; ++i)
     {
-        printf("*");
-        ++i;
+        (*count).limbs[i] = (uint32_t) value;
+        value = value >> 32;
     }
-	return;
+    return;
 }
 
 
-int indexOfMaxValue(double *array, int arraySize)
+void multiplyAddExactCount(ExactCount *count, uint32_t factor, uint32_t addend)
 {
-	int max = 0;
-	for (int i = 0; i < arraySize; ++i)
-	{
-		if (array[i] > array[max])
-		{
-			max = i;
-		}
-	}
-	return max;
+    uint64_t carry = addend;
+    for (int i = 0; i < EXACT_COUNT_LIMBS; ++i)
+    {
+        uint64_t limb = (uint64_t) (*count).limbs[i] * factor + carry;
+        (*count).limbs[i] = (uint32_t) limb;
+        carry = limb >> 32;
+    }
+    return;
 }
 
 
-void roundBeforeHistogram(double *array, int arraySize)
+void multiplyExactCounts(const ExactCount *x, const ExactCount *y, ExactCount *product)
 {
-	for(int i = 0; i < arraySize; ++i)
-	{
-        array[i] = (round(array[i] * 1000)) / 1000;
-	}
-	return;
+    setExactCount(product, 0);
+    for (int i = 0; i < EXACT_COUNT_LIMBS; ++i)
+    {
+        uint64_t carry = 0;
+        for (int k = 0; i + k < EXACT_COUNT_LIMBS; ++k)
+        {
+            uint64_t limb = (uint64_t) (*x).limbs[i] * (*y).limbs[k] + (*product).limbs[i + k] + carry;
+            (*product).limbs[i + k] = (uint32_t) limb;
+            carry = limb >> 32;
+        }
+    }
+    return;
 }
 
 
-int parameterization(int t, int size)
+void addExactCounts(ExactCount *sum, const ExactCount *addend)
 {
-	return (t + (floor(size / 2)));
+    uint64_t carry = 0;
+    for (int i = 0; i < EXACT_COUNT_LIMBS; ++i)
+    {
+        uint64_t limb = (uint64_t) (*sum).limbs[i] + (*addend).limbs[i] + carry;
+        (*sum).limbs[i] = (uint32_t) limb;
+        carry = limb >> 32;
+    }
+    return;
 }
 
 
-void nConvolutions(double *resultArray)
+void subtractExactCounts(ExactCount *difference, const ExactCount *subtrahend)
 {
-	double temp[SAMPLES_UPPER_BOUND];
-	memcpy(temp, gArray, sizeof(double) * SAMPLES_UPPER_BOUND);
-	for (int i = 0; i < n; ++i)
-	{
-		int j = 0;
-        int t = -ceil((double)SAMPLES_UPPER_BOUND / 2)-1;
-		while(t <= floor((double)SAMPLES_UPPER_BOUND / 2)-1)
-		{
-                resultArray[j] = singleConvolution(temp, t);
-				++j;
-                ++t;
-		}
-		memcpy(temp, resultArray, sizeof(double) * SAMPLES_UPPER_BOUND);
-	}
-	return;
+    uint64_t borrow = 0;
+    for (int i = 0; i < EXACT_COUNT_LIMBS; ++i)
+    {
+        uint64_t limb = (uint64_t) (*difference).limbs[i] - (*subtrahend).limbs[i] - borrow;
+        (*difference).limbs[i] = (uint32_t) limb;
+        borrow = (limb >> 32) & 1;
+    }
+    return;
+}
+
+
+int compareExactCounts(const ExactCount *x, const ExactCount *y)
+{
+    for (int i = EXACT_COUNT_LIMBS - 1; i >= 0; --i)
+    {
+        if ((*x).limbs[i] != (*y).limbs[i])
+        {
+            return ((*x).limbs[i] < (*y).limbs[i]) ? -1 : 1;
+        }
+    }
+    return 0;
 }
 
 
-double singleConvolution(double array[], int t)
+double divideExactCounts(const ExactCount *numerator, const ExactCount *denominator)
+{
+    ExactCount remainder = *numerator;
+    ExactCount zero;
+    setExactCount(&zero, 0);
+    if (compareExactCounts(&remainder, &zero) == 0)
+    {
+        return 0;
+    }
+    if (compareExactCounts(&remainder, denominator) >= 0)
+    {
+        return 1;
+    }
+    // long division one bit at a time: the quotient is mantissa * 2^-(position), and the bits
+    // after the mantissa decide the rounding, half to even
+    uint64_t mantissa = 0;
+    int position = 0;
+    int significantBits = 0;
+    int roundBit = 0;
+    while (significantBits <= DOUBLE_MANTISSA_BITS)
+    {
+        addExactCounts(&remainder, &remainder);
+        int bit = compareExactCounts(&remainder, denominator) >= 0;
+        if (bit)
+        {
+            subtractExactCounts(&remainder, denominator);
+        }
+        if (significantBits == DOUBLE_MANTISSA_BITS)
+        {
+            roundBit = bit;
+            break;
+        }
+        ++position;
+        mantissa = mantissa * 2 + bit;
+        significantBits = significantBits + (mantissa != 0);
+    }
+    int sticky = compareExactCounts(&remainder, &zero) != 0;
+    if (roundBit && (sticky || mantissa % 2 != 0))
+    {
+        ++mantissa;
+    }
+    return ldexp((double) mantissa, -position);
+}
+
+double singleConvolution(const KernelPlan *kernel, double array[], int t)
 {
+    int windowSize = (*kernel).windowSize;
 	double sum = 0;
-    int m = -ceil((double)SAMPLES_UPPER_BOUND / 2);
-    while (m <= floor((double)SAMPLES_UPPER_BOUND / 2))
+    int m = -ceil((double)windowSize / 2);
+    while (m <= floor((double)windowSize / 2))
     {
-        if (checkBoundsForSingleConvolution(t, m))
+        if (checkBoundsForSingleConvolution(t, m, windowSize))
         {
-            int i = parameterization(t-m, SAMPLES_UPPER_BOUND);
-            int j = parameterization(m, SAMPLES_UPPER_BOUND);
-            double res = hArray[i] * array[j];
+            int i = parameterization(t-m, windowSize);
+            int j = parameterization(m, windowSize);
+            double res = (*kernel).h[i] * array[j];
             sum = sum + res;
         }
         ++m;
@@ -367,12 +4438,12 @@ double singleConvolution(double array[], int t)
 }
 
 
-int checkBoundsForSingleConvolution(int t, int m)
+int checkBoundsForSingleConvolution(int t, int m, int windowSize)
 {
-    if ((parameterization(m, SAMPLES_UPPER_BOUND) >= 0) &&
-        (parameterization(m, SAMPLES_UPPER_BOUND) < SAMPLES_UPPER_BOUND) &&
-        (parameterization(t-m, SAMPLES_UPPER_BOUND) >= 0) &&
-        (parameterization(t-m, SAMPLES_UPPER_BOUND) < SAMPLES_UPPER_BOUND))
+    if ((parameterization(m, windowSize) >= 0) &&
+        (parameterization(m, windowSize) < windowSize) &&
+        (parameterization(t-m, windowSize) >= 0) &&
+        (parameterization(t-m, windowSize) < windowSize))
     {
         return VALID_BOUNDS;
     }
@@ -380,46 +4451,44 @@ int checkBoundsForSingleConvolution(int t, int m)
 }
 
 
-void normalizeArray(double array[], int arraySize)
+int prepareInputForConvolution(Experiment *experiment, KernelPlan *kernel, double *hSamples, int hSize)
 {
-    double arraySum = 0;
-    for (int i = 0; i < arraySize; ++i)
+    double scale = normalizeArray(hSamples, hSize);
+    if (createKernelPlan(kernel, hSamples, hSize, windowSizeFor((*experiment).gSize)) == ALLOCATION_ERROR)
     {
-        arraySum = arraySum + array[i];
+        return ALLOCATION_ERROR;
     }
-    if(arraySum > 0)
+    (*kernel).scale = scale;
+    return prepareSignal(experiment, kernel);
+}
+
+
+int prepareSignal(Experiment *experiment, const KernelPlan *kernel)
+{
+    (*experiment).scale = normalizeArray((*experiment).g, (*experiment).gSize);
+    if ((*experiment).gSize != (*kernel).windowSize &&
+        fitToWindow(&(*experiment).g, (*experiment).gSize, (*kernel).windowSize) == ALLOCATION_ERROR)
     {
-        for (int i = 0; i < arraySize; ++i)
-        {
-            array[i] = array[i] / arraySum;
-        }
-        return;
+        return ALLOCATION_ERROR;
     }
-    return;
+    centerArray((*experiment).g, (*experiment).gSize, (*kernel).windowSize);
+    (*experiment).kernel = kernel;
+    return CORRECT_INPUT;
 }
 
 
-void prepareInputForConvolution()
+int windowSizeFor(int gSize)
 {
-    normalizeArray(gArray, gSize);
-    normalizeArray(hArray, hSize);
-    centerArray(gArray, gSize);
-    centerArray(hArray, hSize);
-    return;
+    return (gSize > SAMPLES_WINDOW_SIZE) ? gSize : SAMPLES_WINDOW_SIZE;
 }
 
-
-void centerArray(double array[], int arraySize)
+void centerArray(double array[], int arraySize, int windowSize)
 {
-	if (SAMPLES_UPPER_BOUND == arraySize)
+	if (windowSize == arraySize)
 	{
 		return;
 	}
-	int start = (SAMPLES_UPPER_BOUND / 2) - (arraySize / 2);
-    if(arraySize % 2 != 0)
-    {
-        --start;
-    }
+	int start = centerStart(arraySize, windowSize);
     for (int i = arraySize-1; i >= 0; --i)
     {
         array[i + start] = array[i];
@@ -456,44 +4525,6 @@ int findDecimalPointPosition(char *charArray)
 }
 
 
-int getInputArrayLength(char* inputArray)
-{
-	char temp[MAX_LINE_LENGTH];
-	strcpy(temp, inputArray);
-	char *stringRepresentation = NULL;
-	stringRepresentation = strtok(temp, INPUT_DIVIDERS);
-	int i = 0;
-	while(stringRepresentation != NULL)
-	{
-        stringRepresentation = strtok(NULL, INPUT_DIVIDERS);
-		++i;
-	}
-	return i;
-}
-
-
-int convertInputToDoubleArray(char arrayToConvert[], double convertedArray[])
-{
-	char tempArrayToConvert[MAX_LINE_LENGTH];
-	strcpy(tempArrayToConvert, arrayToConvert);
-	char *arr = NULL;
-	arr = strtok(tempArrayToConvert, INPUT_DIVIDERS);
-	int i = 0;
-	while(arr != NULL)
-	{
-		double convertedNumber = extractDoubleFromString(arr);
-		if (convertedNumber == INPUT_ERROR)
-		{
-			return INPUT_ERROR;
-		}
-        convertedArray[i] = convertedNumber;
-		++i;
-        arr = strtok(NULL, INPUT_DIVIDERS);
-	}
-	return CORRECT_INPUT;
-}
-
-
 double extractDoubleFromString(char *array)
 {
 	if (strlen(array) > MAX_VALUE_LENGTH)
@@ -526,4 +4557,4 @@ double extractDoubleFromString(char *array)
 		}
 	}
 	return representedNumber;
-}
\ No newline at end of file
+}
@@ -0,0 +1,259 @@
+#ifndef DRUM_EXPERIMENT_H
+#   define DRUM_EXPERIMENT_H
+
+#   include <complex.h>
+
+/****************************************
+ *  Status codes and arguments, shared with DrumBenchmark.
+ ****************************************/
+/**
+ * @brief Defines an input error output.
+ */
+#   define INPUT_ERROR -1
+
+/**
+ * @brief Defines an input success output.
+ */
+#   define CORRECT_INPUT 0
+
+/**
+ * @brief Defines a successful exit code.
+ */
+#   define SUCCESSFUL_EXIT_CODE 0
+
+/**
+ * @brief Defines a memory allocation error output.
+ */
+#   define ALLOCATION_ERROR -2
+
+/**
+ * @brief The prefix of the argument that sets the number of threads of the direct engines.
+ */
+#   define THREADS_ARGUMENT "--threads="
+
+/****************************************
+ *  Phases of a run.
+ ****************************************/
+/**
+ * @brief Defines the phase that parses the input.
+ */
+#   define PHASE_PARSE 0
+
+/**
+ * @brief Defines the phase that normalizes and centers the input.
+ */
+#   define PHASE_PREPARE 1
+
+/**
+ * @brief Defines the phase that applies the convolutions.
+ */
+#   define PHASE_CONVOLVE 2
+
+/**
+ * @brief Defines the phase that renders and writes the output.
+ */
+#   define PHASE_RENDER 3
+
+/**
+ * @brief Defines the number of phases.
+ */
+#   define NUMBER_OF_PHASES 4
+
+/****************************************
+ *  Types.
+ ****************************************/
+/**
+ * @brief The transform of h raised to the n-th power, which the fft engine multiplies g by
+ */
+typedef struct KernelSpectrum
+{
+    long transformSize; /**< the number of samples in the transform */
+    int n; /**< the power that the transform was raised to */
+    double complex *values; /**< the transform of h raised to n */
+} KernelSpectrum;
+
+/**
+ * @brief A normalized h, prepared once for every window size it is convolved in
+ */
+typedef struct KernelPlan
+{
+    double *h; /**< the normalized h samples, centered in the window */
+    int hSize; /**< the number of samples in h */
+    double scale; /**< the sum that h was divided by when it was normalized */
+    int windowSize; /**< the number of samples in the convolution window */
+    double *reversedTaps; /**< the non zero samples of h, in reversed order */
+    int *tapShifts; /**< for every non zero sample of h, the shift from a g index to the output index it meets */
+    double *tapWeights; /**< the non zero samples of h, in order */
+    int tapsCount; /**< the number of non zero samples of h */
+    int high; /**< the window index of the last non zero sample of h */
+    int offset; /**< the shift between an output index and the h index of the g sample at 0 */
+    KernelSpectrum *spectra; /**< the spectra that the records of a batch share, read only once rendering starts */
+    int spectraCount; /**< the number of spectra */
+} KernelPlan;
+
+/**
+ * @brief The wall and CPU time of a phase, in seconds
+ */
+typedef struct PhaseTime
+{
+    double wall; /**< the elapsed wall clock time */
+    double cpu; /**< the CPU time of all the threads of the process */
+} PhaseTime;
+
+/**
+ * @brief The timings and counters of a run
+ */
+typedef struct Stats
+{
+    PhaseTime phases[NUMBER_OF_PHASES]; /**< the time spent in every phase */
+    int engine; /**< the engine that applied the convolutions */
+    long long multiplyAdds; /**< the multiply-adds the engine performed, 4 per complex product */
+    long long bytesRead; /**< the bytes of the input */
+    long long bytesWritten; /**< the bytes of the output */
+} Stats;
+
+/**
+ * @brief A g signal to convolve n times with a kernel
+ */
+typedef struct Experiment
+{
+    double *g; /**< the normalized g samples, centered in the window of the kernel */
+    int gSize; /**< the number of samples in g */
+    double scale; /**< the sum that g was divided by when it was normalized */
+    int n; /**< the number of iterations for which the convolution will be preformed */
+    const KernelPlan *kernel; /**< the kernel to convolve g with */
+    int iterationsRun; /**< the number of passes that were actually applied */
+    Stats *stats; /**< the stats that the experiment reports to, or NULL */
+} Experiment;
+
+/****************************************
+ *  Preparing an experiment.
+ ****************************************/
+/**
+ * @brief parses a positive integer argument
+ * @param value the argument value
+ * @param result will hold the parsed value
+ * @return INPUT_ERROR if the value is not a positive integer, CORRECT_INPUT otherwise.
+ */
+int parsePositiveArgument(char *value, int *result);
+
+/**
+ * @brief Normalizes and centers g and h arrays.
+ * @param experiment the experiment, holding the parsed g samples
+ * @param kernel will hold the prepared h
+ * @param hSamples the parsed h samples
+ * @param hSize the number of h samples
+ * @return ALLOCATION_ERROR if the buffers could not be allocated, CORRECT_INPUT otherwise.
+ */
+int prepareInputForConvolution(Experiment *experiment, KernelPlan *kernel, double *hSamples, int hSize);
+
+/**
+ * @brief Returns the number of samples in the window of a g signal
+ * @param gSize the number of samples in g
+ */
+int windowSizeFor(int gSize);
+
+/**
+ * @brief Frees the buffers of a kernel plan
+ * @param kernel the kernel to free
+ */
+void freeKernelPlan(KernelPlan *kernel);
+
+/****************************************
+ *  Engines.
+ ****************************************/
+/**
+ * @brief Applies the convolution n times
+ * @param experiment the experiment
+ * @param resultArray the array that will contain the result of the convultion
+ * @return ALLOCATION_ERROR if the intermediate buffer could not be allocated, CORRECT_INPUT otherwise.
+ */
+int nConvolutions(Experiment *experiment, double *resultArray);
+
+/**
+ * @brief Applies the convolution n times like nConvolutions, but the range of g indices that
+ * meet the non zero samples of h is computed once per output index, and the products over that
+ * range are summed by a vectorized dot product against h in reversed order.
+ * @param experiment the experiment
+ * @param resultArray the array that will contain the result of the convolution
+ * @return ALLOCATION_ERROR if the intermediate buffers could not be allocated, CORRECT_INPUT otherwise.
+ */
+int simdConvolutions(Experiment *experiment, double *resultArray);
+
+/**
+ * @brief Applies the convolution n times like simdConvolutions, with the output indices of every
+ * pass partitioned across threads and a barrier between the passes.
+ * @param experiment the experiment
+ * @param resultArray the array that will contain the result of the convolution
+ * @param threads the number of threads
+ * @return ALLOCATION_ERROR if the buffers or the threads could not be allocated, CORRECT_INPUT otherwise.
+ */
+int threadedConvolutions(Experiment *experiment, double *resultArray, int threads);
+
+/**
+ * @brief Applies the convolution n times in the frequency domain: g and h are transformed once,
+ * H is raised to the n-th power pointwise and the product is transformed back once. A spectrum
+ * cached in the kernel replaces the transform and the power of h.
+ * Unlike nConvolutions, the window is applied to the final result only, so mass that leaves
+ * the window in an intermediate pass is not dropped.
+ * @param experiment the experiment
+ * @param resultArray the array that will contain the result of the convolution
+ * @return ALLOCATION_ERROR if the transform buffers could not be allocated, CORRECT_INPUT otherwise.
+ */
+int fftConvolutions(Experiment *experiment, double *resultArray);
+
+/**
+ * @brief Applies the convolution n times like nConvolutions, but every non zero g sample is
+ * scattered through the non zero samples of h only, so the zero padding of the window and the
+ * zero samples of sparse kernels (impulse trains) cost nothing.
+ * @param experiment the experiment
+ * @param resultArray the array that will contain the result of the convolution
+ * @return ALLOCATION_ERROR if the intermediate buffer could not be allocated, CORRECT_INPUT otherwise.
+ */
+int sparseConvolutions(Experiment *experiment, double *resultArray);
+
+/****************************************
+ *  Stats.
+ ****************************************/
+/**
+ * @brief Returns the current wall and CPU time, to time a phase from
+ */
+PhaseTime phaseStart(void);
+
+/**
+ * @brief Adds the time since the start of a phase to the stats
+ * @param stats the stats, or NULL to record nothing
+ * @param phase the phase
+ * @param start the time the phase started at
+ */
+void recordPhase(Stats *stats, int phase, PhaseTime start);
+
+/**
+ * @brief Returns the number of multiply-adds in a pass of the direct engines
+ * @param kernel the kernel
+ * @param dense 1 to count every sample of the window of h, like singleConvolution, 0 to count the
+ * samples of h only, like directConvolutionAt
+ */
+long long passMultiplyAdds(const KernelPlan *kernel, int dense);
+
+/**
+ * @brief Returns the number of butterflies of a radix 2 transform
+ * @param size the size of the transform
+ */
+long long transformButterflies(long size);
+
+/**
+ * @brief Returns the number of multiplications complexPower and modularPower perform
+ * @param exponent the power
+ */
+int powerMultiplications(int exponent);
+
+/**
+ * @brief Returns the size of a transform that holds the n-fold convolution of the window with the
+ * kernel, together with the window itself, so no index of the window wraps around
+ * @param kernel the kernel
+ * @param n the number of convolutions
+ */
+long transformSizeFor(const KernelPlan *kernel, int n);
+
+#endif //DRUM_EXPERIMENT_H
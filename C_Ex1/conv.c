@@ -0,0 +1,268 @@
+#include "conv.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/**
+ * @brief Defined when the compiler builds AVX2 functions without -mavx2. They run only on the
+ * processors that report AVX2, the others take the portable loops.
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#   define AVX2_DISPATCH
+#   include <immintrin.h>
+#endif
+
+/**
+ * @brief Defines the minimal size of the convolution window, a longer g signal widens the window.
+ */
+#define SAMPLES_WINDOW_SIZE 100
+
+/**
+ * @brief Defines the number of partial sums of a dot product, the width of an AVX2 register.
+ */
+#define DOT_PRODUCT_LANES 4
+
+/**
+ * @brief A kernel normalized and centered once for signals of one size. It is read only after it
+ * was created, so it holds everything an execution needs except its buffers.
+ */
+struct ConvolutionPlan
+{
+    int gSize; /**< the number of samples in the signals the plan convolves */
+    int hSize; /**< the number of samples in h */
+    int windowSize; /**< the number of samples in the convolution window */
+    int high; /**< the window index of the last sample of h */
+    int offset; /**< the shift between an output index and the h index of the g sample at 0 */
+    double *reversedTaps; /**< the normalized samples of h, in reversed order */
+};
+
+/**
+ * @brief Returns the output value at an index of one pass, over the g indices that meet h only
+ * @param plan the plan
+ * @param source the centered signal of the pass
+ * @param j the output index
+ */
+static double planConvolutionAt(const ConvolutionPlan *plan, const double *source, int j);
+
+#ifdef AVX2_DISPATCH
+/**
+ * @brief Sums the products of two arrays into DOT_PRODUCT_LANES partial sums with AVX2, in the
+ * order of the portable loop of dotProduct
+ * @param x the first array
+ * @param y the second array
+ * @param length the number of elements in each array
+ * @param partialSums the partial sums, DOT_PRODUCT_LANES of them
+ * @return the number of elements summed, a multiple of DOT_PRODUCT_LANES
+ */
+static int avx2DotProductLanes(const double *x, const double *y, int length, double *partialSums);
+#endif
+
+
+ConvolutionPlan *createConvolutionPlan(const double *h, int hSize, int gSize)
+{
+    if (h == NULL || hSize < 0 || gSize < 0 || hSize > gSize)
+    {
+        return NULL;
+    }
+    ConvolutionPlan *plan = (ConvolutionPlan*) malloc(sizeof(ConvolutionPlan));
+    if (plan == NULL)
+    {
+        return NULL;
+    }
+    (*plan).gSize = gSize;
+    (*plan).hSize = hSize;
+    (*plan).windowSize = (gSize > SAMPLES_WINDOW_SIZE) ? gSize : SAMPLES_WINDOW_SIZE;
+    (*plan).offset = 2 * ((*plan).windowSize / 2) - ((*plan).windowSize + 1) / 2 - 1;
+    (*plan).high = centerStart(hSize, (*plan).windowSize) + hSize - 1;
+    (*plan).reversedTaps = (double*) malloc(sizeof(double) * (hSize > 0 ? hSize : 1));
+    if ((*plan).reversedTaps == NULL)
+    {
+        free(plan);
+        return NULL;
+    }
+    // h is normalized in input order, so its samples are the same as the ones of DrumExperiment
+    for (int i = 0; i < hSize; ++i)
+    {
+        (*plan).reversedTaps[hSize - 1 - i] = h[i];
+    }
+    double hSum = 0;
+    for (int i = hSize - 1; i >= 0; --i)
+    {
+        hSum = hSum + (*plan).reversedTaps[i];
+    }
+    for (int i = 0; hSum > 0 && i < hSize; ++i)
+    {
+        (*plan).reversedTaps[i] = (*plan).reversedTaps[i] / hSum;
+    }
+    return plan;
+}
+
+
+int convolutionWindowSize(const ConvolutionPlan *plan)
+{
+    return (*plan).windowSize;
+}
+
+
+int executeConvolutionPlan(const ConvolutionPlan *plan, const double *g, int gSize, int n, double tolerance,
+                           double *result, int *iterationsRun)
+{
+    if (plan == NULL || g == NULL || result == NULL || gSize != (*plan).gSize || n < 0)
+    {
+        return CONV_INPUT_ERROR;
+    }
+    int windowSize = (*plan).windowSize;
+    double *current = (double*) calloc(windowSize, sizeof(double));
+    if (current == NULL)
+    {
+        return CONV_ALLOCATION_ERROR;
+    }
+    double *signal = current + centerStart(gSize, windowSize);
+    memcpy(signal, g, sizeof(double) * gSize);
+    normalizeArray(signal, gSize);
+    int passes = n;
+    for (int i = 0; i < n; ++i)
+    {
+        for (int j = 0; j < windowSize; ++j)
+        {
+            result[j] = planConvolutionAt(plan, current, j);
+        }
+        if (tolerance > 0 && maxAbsoluteDifference(result, current, windowSize) < tolerance)
+        {
+            passes = i + 1;
+            break;
+        }
+        memcpy(current, result, sizeof(double) * windowSize);
+    }
+    if (n == 0)
+    {
+        memcpy(result, current, sizeof(double) * windowSize);
+    }
+    if (iterationsRun != NULL)
+    {
+        *iterationsRun = passes;
+    }
+    free(current);
+    return CONV_SUCCESS;
+}
+
+
+void freeConvolutionPlan(ConvolutionPlan *plan)
+{
+    if (plan == NULL)
+    {
+        return;
+    }
+    free((*plan).reversedTaps);
+    free(plan);
+}
+
+
+int centerStart(int arraySize, int windowSize)
+{
+    if (windowSize == arraySize)
+    {
+        return 0;
+    }
+    int start = (windowSize / 2) - (arraySize / 2);
+    if (arraySize % 2 != 0)
+    {
+        --start;
+    }
+    return start;
+}
+
+
+double normalizeArray(double array[], int arraySize)
+{
+    double arraySum = 0;
+    for (int i = 0; i < arraySize; ++i)
+    {
+        arraySum = arraySum + array[i];
+    }
+    if (arraySum > 0)
+    {
+        for (int i = 0; i < arraySize; ++i)
+        {
+            array[i] = array[i] / arraySum;
+        }
+        return arraySum;
+    }
+    return 1;
+}
+
+
+static double planConvolutionAt(const ConvolutionPlan *plan, const double *source, int j)
+{
+    return convolutionAt(source, (*plan).windowSize, (*plan).reversedTaps, (*plan).hSize,
+                         (*plan).offset - (*plan).high, j);
+}
+
+
+double convolutionAt(const double *source, int sourceSize, const double *reversedTaps, int tapsCount,
+                     int shift, int j)
+{
+    // source[k] meets reversedTaps[k - base], which is in the kernel for k in [base, base + tapsCount)
+    int base = j + shift;
+    int first = (base > 0) ? base : 0;
+    int last = base + tapsCount - 1;
+    last = (last < sourceSize - 1) ? last : sourceSize - 1;
+    if (first > last)
+    {
+        return 0;
+    }
+    return dotProduct(source + first, reversedTaps + (first - base), last - first + 1);
+}
+
+
+#ifdef AVX2_DISPATCH
+__attribute__((target("avx2")))
+static int avx2DotProductLanes(const double *x, const double *y, int length, double *partialSums)
+{
+    int i = 0;
+    __m256d sums = _mm256_setzero_pd();
+    for (; i + DOT_PRODUCT_LANES <= length; i += DOT_PRODUCT_LANES)
+    {
+        sums = _mm256_add_pd(sums, _mm256_mul_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+    }
+    _mm256_storeu_pd(partialSums, sums);
+    return i;
+}
+#endif
+
+
+double dotProduct(const double *x, const double *y, int length)
+{
+    double partialSums[DOT_PRODUCT_LANES] = {0};
+    int i = 0;
+#ifdef AVX2_DISPATCH
+    if (__builtin_cpu_supports("avx2"))
+    {
+        i = avx2DotProductLanes(x, y, length, partialSums);
+    }
+#endif
+    for (; i + DOT_PRODUCT_LANES <= length; i += DOT_PRODUCT_LANES)
+    {
+        for (int lane = 0; lane < DOT_PRODUCT_LANES; ++lane)
+        {
+            partialSums[lane] = partialSums[lane] + x[i + lane] * y[i + lane];
+        }
+    }
+    for (; i < length; ++i)
+    {
+        partialSums[i % DOT_PRODUCT_LANES] = partialSums[i % DOT_PRODUCT_LANES] + x[i] * y[i];
+    }
+    return (partialSums[0] + partialSums[2]) + (partialSums[1] + partialSums[3]);
+}
+
+
+double maxAbsoluteDifference(const double *x, const double *y, int length)
+{
+    double difference = 0;
+    for (int i = 0; i < length; ++i)
+    {
+        double current = fabs(x[i] - y[i]);
+        difference = (current > difference) ? current : difference;
+    }
+    return difference;
+}
@@ -0,0 +1,84 @@
+#ifndef LIBCONV_CONV_H
+#   define LIBCONV_CONV_H
+
+/****************************************
+ *  Status codes, matching the ones of DrumExperiment.
+ ****************************************/
+#   define CONV_SUCCESS 0
+#   define CONV_INPUT_ERROR -1
+#   define CONV_ALLOCATION_ERROR -2
+
+/* The opaque plan of a kernel for signals of one size */
+typedef struct ConvolutionPlan ConvolutionPlan;
+
+/****************************************
+ *      API
+ ****************************************/
+
+/**
+ * Creates a plan that convolves signals of gSize samples with the given kernel.
+ * The kernel is copied, normalized and centered in the convolution window, which is
+ * max(100, gSize) samples long, like the one of DrumExperiment.
+ * @return The plan, or NULL if a size is negative, h is longer than g or the memory ran out.
+ */
+ConvolutionPlan *createConvolutionPlan(const double *h, int hSize, int gSize);
+
+/**
+ * @return The number of samples the plan writes to the result of an execution.
+ */
+int convolutionWindowSize(const ConvolutionPlan *plan);
+
+/**
+ * Normalizes and centers a copy of g and convolves it n times with the kernel of the plan.
+ * The plan is never modified, so many threads may execute it at once.
+ * @param tolerance stops the passes once no output changes by that much, 0 runs all n passes
+ * @param result must hold convolutionWindowSize(plan) samples
+ * @param iterationsRun if not NULL, will hold the number of passes that were applied
+ * @return CONV_INPUT_ERROR if gSize or n do not fit the plan, CONV_ALLOCATION_ERROR if the
+ * memory ran out, CONV_SUCCESS otherwise.
+ */
+int executeConvolutionPlan(const ConvolutionPlan *plan, const double *g, int gSize, int n, double tolerance,
+                           double *result, int *iterationsRun);
+
+/**
+ * Frees a plan, NULL is ignored.
+ */
+void freeConvolutionPlan(ConvolutionPlan *plan);
+
+/****************************************
+ *      Building blocks of the passes, shared with DrumExperiment
+ ****************************************/
+
+/**
+ * @return The index the samples of an array start at once it is centered in a window.
+ */
+int centerStart(int arraySize, int windowSize);
+
+/**
+ * Normalizes an array to a sum of 1 in place, an array that sums to 0 or less is kept.
+ * @return The sum the array was divided by, or 1 if it was kept.
+ */
+double normalizeArray(double array[], int arraySize);
+
+/**
+ * Computes output index j of one pass: the reversed kernel meets source[j + shift] and the samples
+ * after it, and only the ones inside the source are summed.
+ * @param sourceSize the number of samples in the source
+ * @param tapsCount the number of samples in the reversed kernel
+ * @return The convolution at the output index.
+ */
+double convolutionAt(const double *source, int sourceSize, const double *reversedTaps, int tapsCount,
+                     int shift, int j);
+
+/**
+ * @return The dot product of two arrays, summed in 4 partial sums with or without AVX2, so both
+ * paths give the same result.
+ */
+double dotProduct(const double *x, const double *y, int length);
+
+/**
+ * @return The largest absolute difference between two arrays.
+ */
+double maxAbsoluteDifference(const double *x, const double *y, int length);
+
+#endif //LIBCONV_CONV_H
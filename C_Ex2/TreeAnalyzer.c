@@ -1,8 +1,14 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
-#include <math.h>
 #include <string.h>
 #include <stdlib.h>
-#include "queue.h"
+#include <limits.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 
 
@@ -18,33 +24,98 @@
 #define NOT_A_TREE_ERROR "The given graph is not a tree\n"
 
 /** @brief A string to represent wrong number of segments input error */
-#define NUMBER_OF_INPUT_SEGMENTS_ERROR "Usage: TreeAnalyzer <Graph File Path> <First Vertex> <Second Vertex>\n"
+#define NUMBER_OF_INPUT_SEGMENTS_ERROR "Usage: TreeAnalyzer <Graph File Path> <First Vertex> <Second Vertex>\n" \
+                                       "       TreeAnalyzer <Graph File Path> --queries=<Query File Path>\n"
 
-/** @brief A string to represent the maximum length allowed in an input line */
-#define MAX_INPUT_LENGTH 1024
+/** @brief The flag that answers every "<First Vertex> <Second Vertex>" line of a query file */
+#define QUERIES_FLAG "--queries="
 
+/** @brief The most vertices that a tree may have, every vertex has to fit in an int */
+#define MAX_NUMBER_OF_VERTICES INT_MAX
 
+/** @brief The number of bytes read at once when the graph file cannot be memory mapped */
+#define READ_CHUNK_SIZE 65536
+
+/** @brief The most threads that a BFS splits the expansion of a level between */
+#define MAX_BFS_THREADS 16
+
+/** @brief The number of edges that a level needs before its expansion is split between threads */
+#define PARALLEL_FRONTIER_EDGES 16384
+
+/** @brief The number of vertices that a thread finds before it appends them to the next level */
+#define LOCAL_FRONTIER_SIZE 1024
 
 
-// STRUCTS:
-/** @brief A struct to represent a vertex in a tree */
-typedef struct Vertex
-{
-    long key; /**< the key that this vertex holds */
-    struct Vertex *next; /**< a pointer to the next vertex in the chain */
-} Vertex;
 
 
-/** @brief A struct to represent a Tree of Vertices */
+// STRUCTS:
+/**
+ * @brief A struct to represent a Tree of Vertices, in a compressed sparse row layout: the neighbors
+ * of vertex v are treeStructure[treeOffsets[v]] up to treeStructure[treeOffsets[v + 1] - 1]
+ */
 typedef struct Tree
 {
-    Vertex** treeStructure; /**< an array of Vertices to describe the trees structure */
+    long *treeOffsets; /**< for every vertex the index of its first neighbor, and the neighbors count at the end */
+    long *treeStructure; /**< the neighbors of all the vertices, vertex after vertex */
     int root; /**< the root of this tree */
     long *leafs; /**< an array to represent the leafs of this tree */
     long totalNumberOfVertices; /**< the total number of vertices in this tree */
 } Tree;
 
 
+/** @brief A struct to represent the lengths that the analysis of a tree finds */
+typedef struct TreeMetrics
+{
+    int minimalBranch; /**< the length of the shortest path from the root to a leaf */
+    int maximalBranch; /**< the length of the longest path from the root to a leaf */
+    int diameter; /**< the length of the longest path between two vertices */
+} TreeMetrics;
+
+
+/**
+ * @brief A struct to represent the ancestors of every vertex of a tree, by binary lifting: the 2^k-th
+ * ancestor of vertex v is ancestors[k * totalNumberOfVertices + v], and the root is its own ancestor
+ */
+typedef struct PathIndex
+{
+    int levels; /**< the number of ancestors kept for every vertex, 2^levels is more than any depth */
+    int *depth; /**< the depth of every vertex */
+    int *ancestors; /**< the ancestors of all the vertices, level after level */
+    int *pathBuffer; /**< room for the half of a path that is found from its end */
+} PathIndex;
+
+
+/**
+ * @brief A struct to represent the threads of a level synchronous BFS: the vertices are listed in
+ * order level after level, and the edges of the current level are split evenly between the threads
+ */
+typedef struct BfsPool
+{
+    Tree *pointerToTree; /**< the tree that is traversed */
+    long *order; /**< the vertices in the order they were found */
+    int *distance; /**< the distance of every vertex from the source, -1 until it is found */
+    int *predecessor; /**< the vertex that every vertex was found from, or NULL if it is not needed */
+    long *frontierEdges; /**< for every vertex of the current level, the edges count of the ones before it */
+    long levelBegin; /**< the index in order of the first vertex of the current level */
+    long levelSize; /**< the number of vertices in the current level */
+    long tail; /**< the number of vertices found so far, updated atomically */
+    int parts; /**< the number of parts that the current level is split into */
+    int threads; /**< the number of threads of the pool, the calling thread included */
+    int done; /**< 1 once the traversal is over and the threads should return */
+    pthread_mutex_t gate; /**< held until the number of threads of the pool is known */
+    pthread_barrier_t start; /**< where the threads wait for a level to expand */
+    pthread_barrier_t finish; /**< where the threads wait for the level to be expanded */
+} BfsPool;
+
+
+/** @brief A struct to represent a thread of the pool and the part of every level it expands */
+typedef struct BfsWorker
+{
+    BfsPool *pool; /**< the pool of this thread */
+    int part; /**< the index of the part that this thread expands */
+} BfsWorker;
+
+
 
 
 // METHODS DECLARATION
@@ -57,21 +128,51 @@ int parseInput(char *toParse);
 
 
 /**
- * @brief parses the given file header
- * @param toParse The file header to parse
- * @return the number of different numbers by base 10 in the files header.
+ * @brief parses a line of the graph file, like parseInput but without copying it out of the file
+ * @param begin the first character of the line
+ * @param end the end of the line, without the line break
+ * @return 1 if the given line is valid or 0 otherwise.
  */
-long parseHeader(char *toValidate);
+int parseLine(const char *begin, const char *end);
 
 
 /**
- * @brief parses a vertex to a given trees structure
- * @param vertex the vertex to parse
- * @param key the vertex key
- * @param treeStructure the tree Structure
- * @param vertexIndex the vertex Index
+ * @brief parses the next number of a line, skipping the spaces before it
+ * @param cursor a pointer to the position in the line, moved past the number
+ * @param end the end of the line
+ * @return the number, or LONG_MAX if it is too large, or -1 if the line holds no more numbers.
  */
-void parseTreeVertex(Vertex* vertex, long key, Vertex **treeStructure, long vertexIndex);
+long parseNextNumber(const char **cursor, const char *end);
+
+
+/**
+ * @brief maps the graph file to memory, or reads it if it cannot be mapped
+ * @param inputFilePointer a pointer to the input file
+ * @param length will hold the number of bytes in the file
+ * @param mapped will hold 1 if the file was mapped or 0 if it was read
+ * @return the contents of the file or NULL if it is empty or could not be loaded
+ */
+char *loadGraphFile(FILE *inputFilePointer, size_t *length, int *mapped);
+
+
+/**
+ * @brief releases the contents of the graph file
+ * @param contents the contents of the file
+ * @param length the number of bytes in the file
+ * @param mapped 1 if the file was mapped or 0 if it was read
+ */
+void releaseGraphFile(char *contents, size_t length, int mapped);
+
+
+/**
+ * @brief creates a new tree from the contents of the graph file, in one pass over them
+ * @param input the contents of the graph file
+ * @param inputEnd the end of the contents
+ * @param vertex1 the first input vortex
+ * @param vertex2 the second input vortex
+ * @return a pointer to the created tree or NULL otherwise
+ */
+Tree* parseTree(const char *input, const char *inputEnd, long vertex1, long vertex2);
 
 
 /**
@@ -111,50 +212,54 @@ int checkSizeOfInputVertices(Tree* pointerToTree, int vertex1, int vertex2);
 
 
 /**
- * @brief transfer this tree from a directional to a non directional one
+ * @brief transfer this tree from a directional to a non directional one. Every vertex keeps its
+ * children first, and its parent is added after them.
  * @param pointerToTree a pointer to the tree to transform
+ * @return 0 if successful or -1 if the memory allocation failed.
  */
-void fillToNonDirectedTree(Tree* pointerToTree);
+int fillToNonDirectedTree(Tree* pointerToTree);
 
 
 /**
- * @brief extracts the given trees span
- * @param pointerToTree a pointer to the tree from which to extract the span
- * @return the trees span or -1 otherwise.
+ * @brief lists the vertices that a source reaches in BFS order, one level at a time: a level with
+ * enough edges is expanded by a pool of threads that claim every vertex atomically on its distance,
+ * and a smaller one is expanded by the calling thread alone
+ * @param pointerToTree a pointer to the tree
+ * @param source the vertex the traversal begins at
+ * @param order will hold the vertices in BFS order
+ * @param distance will hold the distance of every vertex from the source, or -1 if it was not reached
+ * @param predecessor if not NULL, will hold the vertex that every vertex was found from, or -1
+ * @return the number of vertices that were reached or -1 if the memory allocation failed.
  */
-int extractSpan(Tree *pointerToTree);
+long levelSynchronousBfs(Tree *pointerToTree, long source, long *order, int *distance, int *predecessor);
 
 
 /**
- * @brief finds the minimum or maximum path in this tree.
- * @param pointerToTree the pointer on the given tree
- * @param flag 1 -> finds max; -1 -> finds min
- * @return the length of the required path
+ * @brief the loop of a thread of the pool, it expands its part of every level until the traversal is over
+ * @param argument a pointer to the BfsWorker of the thread
+ * @return NULL
  */
-int boundedPaths(Tree* pointerToTree, int flag);
+void *bfsWorker(void *argument);
 
 
 /**
- * @brief updates the length of the required path if necessary according to given parameters
- * @param flag
- * @param key1
- * @param key2
- * @param lowerBound
- * @param upperBound
- * @param lB
- * @param uB
+ * @brief expands one part of the current level, and appends the vertices it finds to the next level
+ * @param pool the pool
+ * @param part the index of the part, out of (*pool).parts
  */
-void boundedPathsHelper(int flag, int key1, int key2 , int lowerBound, int upperBound , int* lB, int* uB);
+void expandFrontierPart(BfsPool *pool, int part);
 
 
 /**
- * @brief finds the max path length from a given vortex
+ * @brief finds the branch lengths and the diameter of the tree in one traversal from its root:
+ * the vertices are visited in BFS order, and then in reverse order each vertex takes the height
+ * of its subtree from its children, so the two highest children give the longest path through it.
  * @param pointerToTree a pointer to the tree
- * @param initialVertex the vortex from which the path begins
- * @param maxLength a pointer to the maximum path
- * @return the maximum path length or -1;
+ * @param metrics will hold the lengths that were found
+ * @return 0 if successful, -1 if the memory allocation failed or -2 if the root does not reach
+ * all the vertices.
  */
-int maxPathLengthFromVertex(Tree* pointerToTree, int initialVertex, int* maxLength);
+int analyzeTree(Tree *pointerToTree, TreeMetrics *metrics);
 
 
 /**
@@ -168,11 +273,51 @@ int shortestPathToVertex(Tree *pointerToTree, long initialVertex, long target);
 
 
 /**
- * @brief free vertex list
- * @param listToFree the vertex list to free
- * @param listSize the vertex list length
+ * @brief builds the ancestors of every vertex once, so that every path query is answered in
+ * O(log(n)) time plus the length of the path
+ * @param pointerToTree a pointer to the tree
+ * @param index the index to build, its arrays are freed by freePathIndex
+ * @return 0 if successful, -1 if the memory allocation failed or -2 if the root does not reach
+ * all the vertices.
+ */
+int buildPathIndex(Tree *pointerToTree, PathIndex *index);
+
+
+/**
+ * @brief finds the lowest common ancestor of two vertices
+ * @param pointerToTree a pointer to the tree
+ * @param index the index of the tree
+ * @param vertex1 the first vertex
+ * @param vertex2 the second vertex
+ * @return the deepest vertex that both of the vertices descend from
+ */
+int lowestCommonAncestor(Tree *pointerToTree, PathIndex *index, int vertex1, int vertex2);
+
+
+/**
+ * @brief prints the length of the path between two vertices and the path itself
+ * @param pointerToTree a pointer to the tree
+ * @param index the index of the tree
+ * @param vertex1 the vertex the path begins at
+ * @param vertex2 the vertex the path ends at
+ */
+void printIndexedPath(Tree *pointerToTree, PathIndex *index, int vertex1, int vertex2);
+
+
+/**
+ * @brief answers every line of the query file against the tree of the graph file
+ * @param graphFilePath the path of the graph file
+ * @param queryFilePath the path of the query file, a "<First Vertex> <Second Vertex>" pair per line
+ * @return 0 if successful or 1 otherwise
  */
-void freeVertexList(Vertex **listToFree, int listSize);
+int answerQueryFile(const char *graphFilePath, const char *queryFilePath);
+
+
+/**
+ * @brief frees the arrays of a path index
+ * @param index the index
+ */
+void freePathIndex(PathIndex *index);
 
 
 /**
@@ -182,6 +327,15 @@ void freeVertexList(Vertex **listToFree, int listSize);
 void freeVertexTree(Tree* pointerToTree);
 
 
+/**
+ * @brief allocates an array, after checking that its size in bytes fits in a size_t
+ * @param count the number of elements in the array
+ * @param elementSize the size of an element
+ * @return a pointer to the array or NULL if the size overflows or the memory allocation failed.
+ */
+void *allocateArray(long count, size_t elementSize);
+
+
 /**
  * @brief initiates an integer array to a given value
  * @param arr the array to initiate
@@ -192,11 +346,12 @@ void initiateIntArray(int* arr, int length, int toSet);
 
 
 /**
- * @brief initiates array to NULL values
+ * @brief initiates a long array to a given value
  * @param arr the array to initiate
  * @param length the length of the array
+ * @param toSet the given value
  */
-void initiateArrayForNull(Vertex** arr, int length);
+void initiateLongArray(long* arr, long length, long toSet);
 
 
 /**
@@ -212,6 +367,10 @@ void printshortestPathToVertex(int *arrayToPrint, int index);
 // METHODS IMPLEMENTATION
 int main(int const numberOfInputSegments, char *inputSegments[])
 {
+    if (numberOfInputSegments == 3 && strncmp(inputSegments[2], QUERIES_FLAG, strlen(QUERIES_FLAG)) == 0)
+    {
+        return answerQueryFile(inputSegments[1], inputSegments[2] + strlen(QUERIES_FLAG));
+    }
     if (numberOfInputSegments != 4)
     {
         fprintf(stderr, "%s", NUMBER_OF_INPUT_SEGMENTS_ERROR);
@@ -244,31 +403,25 @@ int main(int const numberOfInputSegments, char *inputSegments[])
     printf("Root Vertex: %d\n", (*pointerToTree).root);
     printf("Vertices Count: %ld\n", (*pointerToTree).totalNumberOfVertices);
     printf("Edges Count: %ld\n", (*pointerToTree).totalNumberOfVertices - 1);
-    fillToNonDirectedTree(pointerToTree);
-    int upperBound = -1;
-    int lowerBound = -1;
-    upperBound = boundedPaths(pointerToTree, 1);
-    lowerBound = boundedPaths(pointerToTree, -1);
-    if(upperBound == -1 || lowerBound == -1)
+    if (fillToNonDirectedTree(pointerToTree) < 0)
     {
         freeVertexTree(pointerToTree);
         pointerToTree = NULL;
         fprintf(stderr, MEMORY_ERROR);
         return 1;
     }
-    printf("Length of Minimal Branch: %d\n", lowerBound);
-    printf("Length of Maximal Branch: %d\n", upperBound);
-    int span = -1;
-    span = extractSpan(pointerToTree);
-    if (span == -1)
+    TreeMetrics metrics;
+    int analysis = analyzeTree(pointerToTree, &metrics);
+    if (analysis < 0)
     {
         freeVertexTree(pointerToTree);
         pointerToTree = NULL;
-        fprintf(stderr, MEMORY_ERROR);
+        fprintf(stderr, "%s", analysis == -1 ? MEMORY_ERROR : NOT_A_TREE_ERROR);
         return 1;
-
     }
-    printf("Diameter Length: %d\n", span);
+    printf("Length of Minimal Branch: %d\n", metrics.minimalBranch);
+    printf("Length of Maximal Branch: %d\n", metrics.maximalBranch);
+    printf("Diameter Length: %d\n", metrics.diameter);
     printf("Shortest Path Between %ld and %ld: ", vertex1, vertex2);
     if (shortestPathToVertex(pointerToTree, vertex1, vertex2) == 0)
     {
@@ -285,17 +438,16 @@ int main(int const numberOfInputSegments, char *inputSegments[])
 
 int extractRoot(Tree *pointerToTree)
 {
-    int *treeEdges = (int*) malloc(sizeof(int) * (*pointerToTree).totalNumberOfVertices);
+    int *treeEdges = (int*) allocateArray((*pointerToTree).totalNumberOfVertices, sizeof(int));
+    if (treeEdges == NULL)
+    {
+        return -1;
+    }
     initiateIntArray(treeEdges, (*pointerToTree).totalNumberOfVertices, 0);
-    int i = 0;
-    while(i < (*pointerToTree).totalNumberOfVertices)
+    long i = 0;
+    while(i < (*pointerToTree).treeOffsets[(*pointerToTree).totalNumberOfVertices])
     {
-        Vertex* curVertex = (*pointerToTree).treeStructure[i];
-        while (curVertex != NULL)
-        {
-            ++treeEdges[(*curVertex).key];
-            curVertex = (*curVertex).next;
-        }
+        ++treeEdges[(*pointerToTree).treeStructure[i]];
         ++i;
     }
     int counter = 0;
@@ -366,6 +518,16 @@ int checkSizeOfInputVertices(Tree* pointerToTree, int vertex1, int vertex2)
 }
 
 
+void *allocateArray(long count, size_t elementSize)
+{
+    if (count < 0 || (unsigned long) count > SIZE_MAX / elementSize)
+    {
+        return NULL;
+    }
+    return malloc((size_t) count * elementSize);
+}
+
+
 void initiateIntArray(int* arr, int length, int toSet)
 {
     for(int i = 0; i < length; ++i)
@@ -376,138 +538,189 @@ void initiateIntArray(int* arr, int length, int toSet)
 }
 
 
-void initiateArrayForNull(Vertex** arr, int length)
+void initiateLongArray(long* arr, long length, long toSet)
 {
-    for(int i = 0; i < length; ++i)
+    for(long i = 0; i < length; ++i)
     {
-        *(arr + i) = NULL;
+        *(arr + i) = toSet;
     }
     return;
 }
 
 
 Tree* createATree(FILE *inputFilePointer, long vertex1, long vertex2)
+{
+    size_t length = 0;
+    int mapped = 0;
+    char *input = loadGraphFile(inputFilePointer, &length, &mapped);
+    if (input == NULL)
+    {
+        fprintf(stderr, INPUT_ERROR);
+        return NULL;
+    }
+    Tree *pointerToTree = parseTree(input, input + length, vertex1, vertex2);
+    releaseGraphFile(input, length, mapped);
+    return pointerToTree;
+}
+
+
+char *loadGraphFile(FILE *inputFilePointer, size_t *length, int *mapped)
+{
+    struct stat fileStatus;
+    *length = 0;
+    *mapped = 0;
+    if (fstat(fileno(inputFilePointer), &fileStatus) == 0 && S_ISREG(fileStatus.st_mode))
+    {
+        if (fileStatus.st_size == 0)
+        {
+            return NULL;
+        }
+        void *contents = mmap(NULL, fileStatus.st_size, PROT_READ, MAP_PRIVATE, fileno(inputFilePointer), 0);
+        if (contents != MAP_FAILED)
+        {
+            *length = fileStatus.st_size;
+            *mapped = 1;
+            return (char*) contents;
+        }
+    }
+    // pipes and other special files are read into a buffer that doubles when it is full
+    size_t capacity = READ_CHUNK_SIZE;
+    char *contents = (char*) malloc(capacity);
+    while (contents != NULL)
+    {
+        size_t readBytes = fread(contents + *length, 1, capacity - *length, inputFilePointer);
+        *length = *length + readBytes;
+        if (*length < capacity)
+        {
+            break;
+        }
+        char *grown = (capacity > SIZE_MAX / 2) ? NULL : (char*) realloc(contents, capacity * 2);
+        if (grown == NULL)
+        {
+            free(contents);
+            return NULL;
+        }
+        contents = grown;
+        capacity = capacity * 2;
+    }
+    if (contents != NULL && *length == 0)
+    {
+        free(contents);
+        return NULL;
+    }
+    return contents;
+}
+
+
+void releaseGraphFile(char *contents, size_t length, int mapped)
+{
+    if (mapped)
+    {
+        munmap(contents, length);
+    }
+    else
+    {
+        free(contents);
+    }
+    return;
+}
+
+
+Tree* parseTree(const char *input, const char *inputEnd, long vertex1, long vertex2)
 {
     Tree *pointerToTree = (Tree*)malloc(sizeof(Tree));
     if (pointerToTree == NULL)
     {
-        freeVertexTree(pointerToTree);
-        pointerToTree = NULL;
         fprintf(stderr, MEMORY_ERROR);
+        return NULL;
     }
+    (*pointerToTree).treeOffsets = NULL;
     (*pointerToTree).treeStructure = NULL;
     (*pointerToTree).leafs = NULL;
     (*pointerToTree).totalNumberOfVertices = 0;
     (*pointerToTree).root = -1;
-    char input[MAX_INPUT_LENGTH];
-    if (fgets(input, MAX_INPUT_LENGTH, inputFilePointer) == NULL)
+    const char *lineEnd = memchr(input, '\n', inputEnd - input);
+    lineEnd = (lineEnd == NULL) ? inputEnd : lineEnd;
+    const char *cursor = input;
+    long actualNumberOfVertices = parseNextNumber(&cursor, lineEnd);
+    // the header is a single number, so nothing but spaces may follow it
+    if (!parseLine(input, lineEnd) || actualNumberOfVertices < 0 ||
+        actualNumberOfVertices > MAX_NUMBER_OF_VERTICES)
     {
         freeVertexTree(pointerToTree);
         pointerToTree = NULL;
         fprintf(stderr, INPUT_ERROR);
         return NULL;
     }
-    strtok(input, "\n");
-    Vertex **treeStructure = NULL;
-    char *temp = NULL;
-    if (parseInput(input))
+    (*pointerToTree).totalNumberOfVertices = actualNumberOfVertices;
+    (*pointerToTree).leafs = (long*) allocateArray(actualNumberOfVertices, sizeof(long));
+    if(checkSizeOfInputVertices(pointerToTree, vertex1, vertex2) || (*pointerToTree).leafs == NULL ||
+       parseNextNumber(&cursor, lineEnd) != -1)
     {
-        (*pointerToTree).totalNumberOfVertices = strtoul(input, &temp, 10);
-        (*pointerToTree).leafs = (long*) malloc(sizeof(long) * strtoul(input, &temp, 10));
-        if(checkSizeOfInputVertices(pointerToTree, vertex1, vertex2) || (*pointerToTree).leafs == NULL)
-        {
-            freeVertexTree(pointerToTree);
-            pointerToTree = NULL;
-            fprintf(stderr, INPUT_ERROR);
-            return NULL;
-        }
-        initiateIntArray((int*)(*pointerToTree).leafs, (int)strtoul(input, &temp, 10), 0);
-        if (parseHeader(input) > 1)
-        {
-            freeVertexTree(pointerToTree);
-            pointerToTree = NULL;
-            fprintf(stderr, INPUT_ERROR);
-            return NULL;
-        }
-        treeStructure = (Vertex**)malloc(sizeof(Vertex*) * strtoul(input, &temp, 10));
-        if (treeStructure == NULL)
-        {
-            freeVertexTree(pointerToTree);
-            pointerToTree = NULL;
-            fprintf(stderr, MEMORY_ERROR);
-            return NULL;
-        }
-        (*pointerToTree).treeStructure = treeStructure;
-        initiateArrayForNull(treeStructure, (long)strtoul(input, &temp, 10) );
+        freeVertexTree(pointerToTree);
+        pointerToTree = NULL;
+        fprintf(stderr, INPUT_ERROR);
+        return NULL;
     }
-    else
+    initiateLongArray((*pointerToTree).leafs, actualNumberOfVertices, 0);
+    // a tree has one edge less than vertices, so the children of all the vertices fit in it
+    long edgesCapacity = actualNumberOfVertices > 1 ? actualNumberOfVertices - 1 : 1;
+    (*pointerToTree).treeOffsets = (long*) allocateArray(actualNumberOfVertices + 1, sizeof(long));
+    (*pointerToTree).treeStructure = (long*) allocateArray(edgesCapacity, sizeof(long));
+    if ((*pointerToTree).treeOffsets == NULL || (*pointerToTree).treeStructure == NULL)
     {
         freeVertexTree(pointerToTree);
         pointerToTree = NULL;
-        fprintf(stderr, INPUT_ERROR);
+        fprintf(stderr, MEMORY_ERROR);
         return NULL;
     }
+    initiateLongArray((*pointerToTree).treeOffsets, actualNumberOfVertices + 1, 0);
     long edgesCounter = 0;
-    long verticesCounter = 0;
     long key = 0;
-    long actualNumberOfVertices = strtoul(input, &temp, 10);
-    while ((fgets(input, MAX_INPUT_LENGTH, inputFilePointer) != NULL) && (verticesCounter < actualNumberOfVertices))
+    const char *line = (lineEnd < inputEnd) ? lineEnd + 1 : inputEnd;
+    while (line < inputEnd && key < actualNumberOfVertices)
     {
-        strtok(input, "\n");
-        if (parseInput(input))
-        {
-            ++verticesCounter;
-            if (*input == '-')
-            {
-                (*pointerToTree).leafs[key] = 1;
-                ++key;
-                continue;
-            }
-            long vertexNum;
-            temp = input;
-            while (*temp != '\0')
-            {
-                vertexNum = strtoul(temp, &temp, 10);
-                // check if this is this a valid num for a node
-                Vertex* vertex = (Vertex*)malloc(sizeof(Vertex));
-                if(vertex == NULL)
-                {
-                    freeVertexTree(pointerToTree);
-                    pointerToTree = NULL;
-                    treeStructure = NULL;
-                    fprintf(stderr, INPUT_ERROR);
-                    return NULL;
-                }
-
-                if (vertexNum >= actualNumberOfVertices)
-                {
-                    free((*vertex).next);
-                    free(vertex);
-                    freeVertexTree(pointerToTree);
-                    pointerToTree = NULL;
-                    treeStructure = NULL;
-                    fprintf(stderr, INPUT_ERROR);
-                    return NULL;
-                }
-                parseTreeVertex(vertex, vertexNum, treeStructure, key);
-                ++edgesCounter;
-            }
-            ++key;
-        }
-        else
+        lineEnd = memchr(line, '\n', inputEnd - line);
+        lineEnd = (lineEnd == NULL) ? inputEnd : lineEnd;
+        if (!parseLine(line, lineEnd))
         {
             freeVertexTree(pointerToTree);
             pointerToTree = NULL;
-            treeStructure = NULL;
             fprintf(stderr, INPUT_ERROR);
             return NULL;
         }
+        // the lines are in vertex order, so the children of every vertex are stored contiguously
+        (*pointerToTree).treeOffsets[key] = edgesCounter;
+        if (*line == '-')
+        {
+            (*pointerToTree).leafs[key] = 1;
+        }
+        cursor = line;
+        long vertexNum;
+        while (*line != '-' && (vertexNum = parseNextNumber(&cursor, lineEnd)) != -1)
+        {
+            // check if this is this a valid num for a node
+            if (vertexNum >= actualNumberOfVertices)
+            {
+                freeVertexTree(pointerToTree);
+                pointerToTree = NULL;
+                fprintf(stderr, INPUT_ERROR);
+                return NULL;
+            }
+            // the extra edges of a graph that is not a tree are counted, but not stored
+            if (edgesCounter < actualNumberOfVertices - 1)
+            {
+                (*pointerToTree).treeStructure[edgesCounter] = vertexNum;
+            }
+            ++edgesCounter;
+        }
+        ++key;
+        line = (lineEnd < inputEnd) ? lineEnd + 1 : inputEnd;
     }
-    if (verticesCounter != actualNumberOfVertices)
+    if (key != actualNumberOfVertices)
     {
         freeVertexTree(pointerToTree);
         pointerToTree = NULL;
-        treeStructure = NULL;
         fprintf(stderr, INPUT_ERROR);
         return NULL;
     }
@@ -515,16 +728,15 @@ Tree* createATree(FILE *inputFilePointer, long vertex1, long vertex2)
     {
         freeVertexTree(pointerToTree);
         pointerToTree = NULL;
-        treeStructure = NULL;
         fprintf(stderr, NOT_A_TREE_ERROR);
         return NULL;
     }
+    (*pointerToTree).treeOffsets[actualNumberOfVertices] = edgesCounter;
     (*pointerToTree).root = extractRoot(pointerToTree);
     if ((*pointerToTree).root == -1)
     {
         freeVertexTree(pointerToTree);
         pointerToTree = NULL;
-        treeStructure = NULL;
         fprintf(stderr, NOT_A_TREE_ERROR);
         return NULL;
     }
@@ -532,67 +744,55 @@ Tree* createATree(FILE *inputFilePointer, long vertex1, long vertex2)
 }
 
 
-long parseHeader(char *toValidate)
+int parseLine(const char *begin, const char *end)
 {
-    long count = 0;
-    while (*toValidate != '\0')
+    if (end - begin == 1 && *begin == '-')
+    {
+        return 1;
+    }
+    int checker = 1;
+    while (begin < end)
     {
-        strtoul(toValidate, &toValidate, 10);
-        ++count;
+        if ((*begin >= '0' && *begin <= '9'))
+        {
+            checker = 0;
+        }
+        else if (*begin != ' ')
+        {
+            return 0;
+        }
+        ++begin;
     }
-    return count;
+    return !(checker);
 }
 
 
-void parseTreeVertex(Vertex* vertex, long key, Vertex **treeStructure, long vertexIndex)
+long parseNextNumber(const char **cursor, const char *end)
 {
-    if(vertex != NULL)
+    while (*cursor < end && **cursor == ' ')
     {
-        (*vertex).key = key;
-        (*vertex).next = NULL;
+        ++(*cursor);
     }
-    Vertex* current = treeStructure[vertexIndex];
-    Vertex* previous = NULL;
-    if (current == NULL)
+    if (*cursor == end || **cursor < '0' || **cursor > '9')
     {
-        treeStructure[vertexIndex] = vertex;
+        return -1;
     }
-    else
+    long number = 0;
+    while (*cursor < end && **cursor >= '0' && **cursor <= '9')
     {
-        while (current != NULL)
-        {
-            previous = current;
-            current = (*current).next;
-        }
-        (*previous).next = vertex;
+        int digit = **cursor - '0';
+        number = (number > (LONG_MAX - digit) / 10) ? LONG_MAX : number * 10 + digit;
+        ++(*cursor);
     }
-    return;
+    return number;
 }
 
 
-void freeVertexList(Vertex **listToFree, int listSize)
+void freePathIndex(PathIndex *index)
 {
-    if (listToFree == NULL)
-    {
-        return;
-    }
-    int i = 0;
-    while(i < listSize)
-    {
-        if (listToFree[i] != NULL)
-        {
-            Vertex* vertex = listToFree[i];
-            Vertex* temp;
-            while (vertex != NULL)
-            {
-                temp = vertex;
-                vertex = (*vertex).next;
-                free(temp);
-            }
-        }
-        ++i;
-    }
-    free(listToFree);
+    free((*index).depth);
+    free((*index).pathBuffer);
+    free((*index).ancestors);
     return;
 }
 
@@ -601,7 +801,8 @@ void freeVertexTree(Tree* pointerToTree)
 {
     if (pointerToTree != NULL)
     {
-        freeVertexList((*pointerToTree).treeStructure, (*pointerToTree).totalNumberOfVertices);
+        free((*pointerToTree).treeOffsets);
+        free((*pointerToTree).treeStructure);
         free((*pointerToTree).leafs);
         free(pointerToTree);
     }
@@ -609,174 +810,310 @@ void freeVertexTree(Tree* pointerToTree)
 }
 
 
-void fillToNonDirectedTree(Tree* pointerToTree)
+int fillToNonDirectedTree(Tree* pointerToTree)
 {
-    int i = 0;
-    while(i < (*pointerToTree).totalNumberOfVertices)
+    long numberOfVertices = (*pointerToTree).totalNumberOfVertices;
+    long *childOffsets = (*pointerToTree).treeOffsets;
+    long *children = (*pointerToTree).treeStructure;
+    // a negative count is rejected by allocateArray, so an edges count that overflows is never allocated
+    long edgesCount = (numberOfVertices <= 1) ? 1 : (numberOfVertices - 1 > LONG_MAX / 2) ? -1 :
+                      2 * (numberOfVertices - 1);
+    long *treeOffsets = (long*) allocateArray(numberOfVertices + 1, sizeof(long));
+    long *treeStructure = (long*) allocateArray(edgesCount, sizeof(long));
+    if (treeOffsets == NULL || treeStructure == NULL)
+    {
+        free(treeOffsets);
+        free(treeStructure);
+        return -1;
+    }
+    // first pass: every vertex but the root has its children and one parent
+    treeOffsets[0] = 0;
+    long i = 0;
+    while(i < numberOfVertices)
     {
-        Vertex* curVertex = (*pointerToTree).treeStructure[i];
-        while (curVertex != NULL)
+        long degree = childOffsets[i + 1] - childOffsets[i] + (i != (*pointerToTree).root);
+        treeOffsets[i + 1] = treeOffsets[i] + degree;
+        ++i;
+    }
+    // second pass: copy the children, and add every vertex as the last neighbor of its children
+    i = 0;
+    while(i < numberOfVertices)
+    {
+        long position = treeOffsets[i];
+        for (long edge = childOffsets[i]; edge < childOffsets[i + 1]; ++edge)
         {
-            Vertex* connectedVertex = (Vertex*) malloc(sizeof(Vertex));
-            if (connectedVertex == NULL)
-            {
-                fprintf(stderr, MEMORY_ERROR);
-                return;
-            }
-            parseTreeVertex(connectedVertex, i, (*pointerToTree).treeStructure, (*curVertex).key);
-            curVertex = (*curVertex).next;
+            treeStructure[position] = children[edge];
+            treeStructure[treeOffsets[children[edge] + 1] - 1] = i;
+            ++position;
         }
         ++i;
     }
-    return;
+    (*pointerToTree).treeOffsets = treeOffsets;
+    (*pointerToTree).treeStructure = treeStructure;
+    free(childOffsets);
+    free(children);
+    return 0;
 }
 
 
-int boundedPaths(Tree* pointerToTree, int flag)
+long levelSynchronousBfs(Tree *pointerToTree, long source, long *order, int *distance, int *predecessor)
 {
-    int *distanceArray = (int*) malloc(sizeof(int) * (*pointerToTree).totalNumberOfVertices);
-    if (distanceArray == NULL)
+    long totalNumberOfVertices = (*pointerToTree).totalNumberOfVertices;
+    BfsPool pool;
+    pool.frontierEdges = (long*) allocateArray(totalNumberOfVertices + 1, sizeof(long));
+    if (pool.frontierEdges == NULL)
     {
-        fprintf(stderr, MEMORY_ERROR);
-        return 0;
+        return -1;
     }
-    initiateIntArray(distanceArray, (*pointerToTree).totalNumberOfVertices, -1);
-    distanceArray[(*pointerToTree).root] = 0;
-    Queue* queueForBfs = allocQueue();
-    enqueue(queueForBfs, (*pointerToTree).root);
-    long currentNumber = 0;
-    Vertex* toConnect = NULL;
-    int upperBound = 0;
-    int lowerBound = (int)pow((*pointerToTree).totalNumberOfVertices, 2) + 1;
-    while (!queueIsEmpty(queueForBfs))
-    {
-        currentNumber = dequeue(queueForBfs);
-        toConnect = (*pointerToTree).treeStructure[currentNumber];
-        while (toConnect != NULL)
-        {
-            if (distanceArray[(*toConnect).key] == -1)
-            {
-                enqueue(queueForBfs, (*toConnect).key);
-                distanceArray[(*toConnect).key] = distanceArray[currentNumber] + 1;
-                boundedPathsHelper(flag, distanceArray[(*toConnect).key], (*pointerToTree).leafs[(*toConnect).key] ,
-                                   lowerBound, upperBound , &lowerBound, &upperBound);
-            }
-            toConnect = (*toConnect).next;
+    pool.pointerToTree = pointerToTree;
+    pool.order = order;
+    pool.distance = distance;
+    pool.predecessor = predecessor;
+    initiateIntArray(distance, totalNumberOfVertices, -1);
+    if (predecessor != NULL)
+    {
+        initiateIntArray(predecessor, totalNumberOfVertices, -1);
+    }
+    distance[source] = 0;
+    order[0] = source;
+    pool.levelBegin = 0;
+    pool.levelSize = 1;
+    pool.tail = 1;
+    pool.done = 0;
+    // a small tree never has a level worth splitting, so no threads are started for it
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int wanted = (totalNumberOfVertices < PARALLEL_FRONTIER_EDGES || cores < 2) ? 1 :
+                 (cores > MAX_BFS_THREADS ? MAX_BFS_THREADS : (int) cores);
+    pthread_t threads[MAX_BFS_THREADS];
+    BfsWorker workers[MAX_BFS_THREADS];
+    pool.threads = 1;
+    pthread_mutex_init(&pool.gate, NULL);
+    pthread_mutex_lock(&pool.gate);
+    for (int i = 1; i < wanted; ++i)
+    {
+        workers[i].pool = &pool;
+        workers[i].part = i;
+        if (pthread_create(&threads[i], NULL, bfsWorker, &workers[i]) != 0)
+        {
+            break;
         }
+        ++pool.threads;
     }
-    free(distanceArray);
-    freeQueue(&queueForBfs);
-    if(flag < 0)
+    pthread_barrier_init(&pool.start, NULL, pool.threads);
+    pthread_barrier_init(&pool.finish, NULL, pool.threads);
+    pthread_mutex_unlock(&pool.gate);
+    while (pool.levelSize > 0)
+    {
+        long edges = 0;
+        for (long i = 0; i < pool.levelSize; ++i)
+        {
+            long vertex = order[pool.levelBegin + i];
+            pool.frontierEdges[i] = edges;
+            edges = edges + (*pointerToTree).treeOffsets[vertex + 1] - (*pointerToTree).treeOffsets[vertex];
+        }
+        pool.frontierEdges[pool.levelSize] = edges;
+        long levelEnd = pool.tail;
+        if (pool.threads == 1 || edges < PARALLEL_FRONTIER_EDGES)
+        {
+            pool.parts = 1;
+            expandFrontierPart(&pool, 0);
+        }
+        else
+        {
+            pool.parts = pool.threads;
+            pthread_barrier_wait(&pool.start);
+            expandFrontierPart(&pool, 0);
+            pthread_barrier_wait(&pool.finish);
+        }
+        pool.levelBegin = levelEnd;
+        pool.levelSize = pool.tail - levelEnd;
+    }
+    pool.done = 1;
+    if (pool.threads > 1)
+    {
+        pthread_barrier_wait(&pool.start);
+    }
+    for (int i = 1; i < pool.threads; ++i)
     {
-        return lowerBound;
+        pthread_join(threads[i], NULL);
     }
-    return upperBound;
+    pthread_barrier_destroy(&pool.start);
+    pthread_barrier_destroy(&pool.finish);
+    pthread_mutex_destroy(&pool.gate);
+    free(pool.frontierEdges);
+    return pool.tail;
 }
 
 
-void boundedPathsHelper(int flag, int key1, int key2 , int lowerBound, int upperBound , int* lB, int* uB)
+void *bfsWorker(void *argument)
 {
-    if ((flag < 0) && (key1 < lowerBound) && key2 == 1)
+    BfsWorker *worker = (BfsWorker*) argument;
+    BfsPool *pool = (*worker).pool;
+    pthread_mutex_lock(&(*pool).gate);
+    pthread_mutex_unlock(&(*pool).gate);
+    while (1)
     {
-        *lB = key1;
-    }
-    if ((flag > 0) && (key1 > upperBound) && key2 == 1)
-    {
-        *uB = key1;
+        pthread_barrier_wait(&(*pool).start);
+        if ((*pool).done)
+        {
+            break;
+        }
+        expandFrontierPart(pool, (*worker).part);
+        pthread_barrier_wait(&(*pool).finish);
     }
-    return;
+    return NULL;
 }
 
 
-int maxPathLengthFromVertex(Tree* pointerToTree, int initialVertex, int* maxLength)
+void expandFrontierPart(BfsPool *pool, int part)
 {
-    int *distanceArray = (int*) malloc(sizeof(int) * (*pointerToTree).totalNumberOfVertices);
-    if (distanceArray == NULL)
+    long *treeOffsets = (*(*pool).pointerToTree).treeOffsets;
+    long *treeStructure = (*(*pool).pointerToTree).treeStructure;
+    long *frontierEdges = (*pool).frontierEdges;
+    long edges = frontierEdges[(*pool).levelSize];
+    long first = edges * part / (*pool).parts;
+    long last = edges * (part + 1) / (*pool).parts;
+    // the part begins at the last vertex whose edges begin at or before its first edge
+    long low = 0;
+    long high = (*pool).levelSize - 1;
+    while (low < high)
     {
-        fprintf(stderr, MEMORY_ERROR);
-        return -1;
+        long middle = (low + high + 1) / 2;
+        if (frontierEdges[middle] <= first)
+        {
+            low = middle;
+        }
+        else
+        {
+            high = middle - 1;
+        }
     }
-    initiateIntArray(distanceArray, (*pointerToTree).totalNumberOfVertices, -1);
-    distanceArray[initialVertex] = 0;
-    Queue* queueForBfs = allocQueue();
-    enqueue(queueForBfs, initialVertex);
-    *maxLength = initialVertex;
-    int maxLengthFound = 0;
-    while (!queueIsEmpty(queueForBfs))
+    long found[LOCAL_FRONTIER_SIZE];
+    int foundCount = 0;
+    for (long i = low; i < (*pool).levelSize && frontierEdges[i] < last; ++i)
     {
-        long currentNumber = dequeue(queueForBfs);
-        Vertex* toConnect = (*pointerToTree).treeStructure[currentNumber];
-        while (toConnect != NULL)
+        long vertex = (*pool).order[(*pool).levelBegin + i];
+        long skipped = (first > frontierEdges[i]) ? first - frontierEdges[i] : 0;
+        long taken = last - frontierEdges[i];
+        long degree = treeOffsets[vertex + 1] - treeOffsets[vertex];
+        long lastEdge = treeOffsets[vertex] + (taken < degree ? taken : degree);
+        int nextDistance = (*pool).distance[vertex] + 1;
+        for (long edge = treeOffsets[vertex] + skipped; edge < lastEdge; ++edge)
         {
-            if (distanceArray[(*toConnect).key] == -1)
+            long neighbor = treeStructure[edge];
+            int unvisited = -1;
+            if (__atomic_load_n(&(*pool).distance[neighbor], __ATOMIC_RELAXED) != -1 ||
+                !__atomic_compare_exchange_n(&(*pool).distance[neighbor], &unvisited, nextDistance, 0,
+                                             __ATOMIC_RELAXED, __ATOMIC_RELAXED))
             {
-                enqueue(queueForBfs, (*toConnect).key);
-                distanceArray[(*toConnect).key] = distanceArray[currentNumber] + 1;
-                if (distanceArray[(*toConnect).key] > maxLengthFound)
-                {
-                    *maxLength = (*toConnect).key;
-                    maxLengthFound = distanceArray[(*toConnect).key];
-                }
+                continue;
+            }
+            if ((*pool).predecessor != NULL)
+            {
+                (*pool).predecessor[neighbor] = (int) vertex;
+            }
+            found[foundCount++] = neighbor;
+            if (foundCount == LOCAL_FRONTIER_SIZE)
+            {
+                long position = __atomic_fetch_add(&(*pool).tail, foundCount, __ATOMIC_RELAXED);
+                memcpy((*pool).order + position, found, sizeof(long) * foundCount);
+                foundCount = 0;
             }
-            toConnect = (*toConnect).next;
         }
     }
-    free(distanceArray);
-    freeQueue(&queueForBfs);
-    return maxLengthFound;
+    if (foundCount > 0)
+    {
+        long position = __atomic_fetch_add(&(*pool).tail, foundCount, __ATOMIC_RELAXED);
+        memcpy((*pool).order + position, found, sizeof(long) * foundCount);
+    }
 }
 
 
-int extractSpan(Tree *pointerToTree)
+int analyzeTree(Tree *pointerToTree, TreeMetrics *metrics)
 {
-    int temp1;
-    int temp2;
-    int span = -1;
-    if (maxPathLengthFromVertex(pointerToTree, (*pointerToTree).root, &temp1))
+    long totalNumberOfVertices = (*pointerToTree).totalNumberOfVertices;
+    long *order = (long*) allocateArray(totalNumberOfVertices, sizeof(long));
+    int *depth = (int*) allocateArray(totalNumberOfVertices, sizeof(int));
+    int *height = (int*) allocateArray(totalNumberOfVertices, sizeof(int));
+    if (order == NULL || depth == NULL || height == NULL)
+    {
+        free(order);
+        free(depth);
+        free(height);
+        return -1;
+    }
+    long visited = levelSynchronousBfs(pointerToTree, (*pointerToTree).root, order, depth, NULL);
+    if (visited != totalNumberOfVertices)
     {
-        span = maxPathLengthFromVertex(pointerToTree, temp1, &temp2);
+        free(order);
+        free(depth);
+        free(height);
+        return (visited < 0) ? -1 : -2;
     }
-    return span;
+    (*metrics).minimalBranch = INT_MAX;
+    (*metrics).maximalBranch = 0;
+    (*metrics).diameter = 0;
+    // the parent of every vertex but the root is its last neighbor, so the rest are its children
+    for (long i = visited - 1; i >= 0; --i)
+    {
+        long currentNumber = order[i];
+        long lastChild = (*pointerToTree).treeOffsets[currentNumber + 1] - (currentNumber != (*pointerToTree).root);
+        int highest = 0;
+        int secondHighest = 0;
+        for (long edge = (*pointerToTree).treeOffsets[currentNumber]; edge < lastChild; ++edge)
+        {
+            int throughChild = height[(*pointerToTree).treeStructure[edge]] + 1;
+            if (throughChild > highest)
+            {
+                secondHighest = highest;
+                highest = throughChild;
+            }
+            else if (throughChild > secondHighest)
+            {
+                secondHighest = throughChild;
+            }
+        }
+        height[currentNumber] = highest;
+        if (highest + secondHighest > (*metrics).diameter)
+        {
+            (*metrics).diameter = highest + secondHighest;
+        }
+        if ((*pointerToTree).leafs[currentNumber] == 1)
+        {
+            if (depth[currentNumber] < (*metrics).minimalBranch)
+            {
+                (*metrics).minimalBranch = depth[currentNumber];
+            }
+            if (depth[currentNumber] > (*metrics).maximalBranch)
+            {
+                (*metrics).maximalBranch = depth[currentNumber];
+            }
+        }
+    }
+    free(order);
+    free(depth);
+    free(height);
+    return 0;
 }
-
-
 int shortestPathToVertex(Tree *pointerToTree, long initialVertex, long target)
 {
-    int *recallVertex = (int*) malloc(sizeof(int) * (*pointerToTree).totalNumberOfVertices);
-    int *distanceArray = (int*) malloc(sizeof(int) * (*pointerToTree).totalNumberOfVertices);
-    if (distanceArray == NULL || recallVertex == NULL)
+    int *recallVertex = (int*) allocateArray((*pointerToTree).totalNumberOfVertices, sizeof(int));
+    int *distanceArray = (int*) allocateArray((*pointerToTree).totalNumberOfVertices, sizeof(int));
+    long *order = (long*) allocateArray((*pointerToTree).totalNumberOfVertices, sizeof(long));
+    if (distanceArray == NULL || recallVertex == NULL || order == NULL ||
+        levelSynchronousBfs(pointerToTree, initialVertex, order, distanceArray, recallVertex) < 0)
     {
         free(recallVertex);
         free(distanceArray);
+        free(order);
         fprintf(stderr, MEMORY_ERROR);
         return 0;
     }
-    initiateIntArray(distanceArray, (*pointerToTree).totalNumberOfVertices, -1);
-    initiateIntArray(recallVertex, (*pointerToTree).totalNumberOfVertices, -1);
-    distanceArray[initialVertex] = 0;
-    Queue* queueForBfs = allocQueue();
-    enqueue(queueForBfs, initialVertex);
-    long currentNumber = 0;
-    while (!queueIsEmpty(queueForBfs))
-    {
-        currentNumber = dequeue(queueForBfs);
-        Vertex* toConnect = (*pointerToTree).treeStructure[currentNumber];
-        while (toConnect != NULL)
-        {
-            if (distanceArray[(*toConnect).key] == -1)
-            {
-                enqueue(queueForBfs, (*toConnect).key);
-                distanceArray[(*toConnect).key] = distanceArray[currentNumber] + 1;
-                recallVertex[(*toConnect).key] = currentNumber;
-            }
-            toConnect = (*toConnect).next;
-        }
-    }
     printshortestPathToVertex(recallVertex, target);
     printf("\n");
     free(recallVertex);
     free(distanceArray);
-    freeQueue(&queueForBfs);
+    free(order);
     return 1;
 }
 
@@ -793,4 +1130,199 @@ void printshortestPathToVertex(int *arrayToPrint, int index)
         printf("%d ", index);
     }
     return;
+}
+
+
+int buildPathIndex(Tree *pointerToTree, PathIndex *index)
+{
+    long totalNumberOfVertices = (*pointerToTree).totalNumberOfVertices;
+    long *order = (long*) allocateArray(totalNumberOfVertices, sizeof(long));
+    (*index).depth = (int*) allocateArray(totalNumberOfVertices, sizeof(int));
+    (*index).pathBuffer = (int*) allocateArray(totalNumberOfVertices, sizeof(int));
+    (*index).ancestors = NULL;
+    if (order == NULL || (*index).depth == NULL || (*index).pathBuffer == NULL)
+    {
+        free(order);
+        return -1;
+    }
+    long visited = levelSynchronousBfs(pointerToTree, (*pointerToTree).root, order, (*index).depth, NULL);
+    if (visited != totalNumberOfVertices)
+    {
+        free(order);
+        return (visited < 0) ? -1 : -2;
+    }
+    // the last vertex in BFS order is one of the deepest
+    int maxDepth = (*index).depth[order[visited - 1]];
+    (*index).levels = 1;
+    while ((*index).levels < 31 && (1 << (*index).levels) <= maxDepth)
+    {
+        ++(*index).levels;
+    }
+    long ancestorsCount = (totalNumberOfVertices > LONG_MAX / (*index).levels) ? -1 :
+                          (*index).levels * totalNumberOfVertices;
+    (*index).ancestors = (int*) allocateArray(ancestorsCount, sizeof(int));
+    if ((*index).ancestors == NULL)
+    {
+        free(order);
+        return -1;
+    }
+    int *parents = (*index).ancestors;
+    for (long vertex = 0; vertex < totalNumberOfVertices; ++vertex)
+    {
+        parents[vertex] = (vertex == (*pointerToTree).root) ? (int) vertex :
+                          (int) (*pointerToTree).treeStructure[(*pointerToTree).treeOffsets[vertex + 1] - 1];
+    }
+    for (int level = 1; level < (*index).levels; ++level)
+    {
+        int *previous = (*index).ancestors + (long) (level - 1) * totalNumberOfVertices;
+        int *current = previous + totalNumberOfVertices;
+        for (long vertex = 0; vertex < totalNumberOfVertices; ++vertex)
+        {
+            current[vertex] = previous[previous[vertex]];
+        }
+    }
+    free(order);
+    return 0;
+}
+
+
+int lowestCommonAncestor(Tree *pointerToTree, PathIndex *index, int vertex1, int vertex2)
+{
+    long totalNumberOfVertices = (*pointerToTree).totalNumberOfVertices;
+    if ((*index).depth[vertex1] < (*index).depth[vertex2])
+    {
+        int temp = vertex1;
+        vertex1 = vertex2;
+        vertex2 = temp;
+    }
+    int difference = (*index).depth[vertex1] - (*index).depth[vertex2];
+    for (int level = 0; difference > 0; ++level, difference >>= 1)
+    {
+        if (difference & 1)
+        {
+            vertex1 = (*index).ancestors[level * totalNumberOfVertices + vertex1];
+        }
+    }
+    if (vertex1 == vertex2)
+    {
+        return vertex1;
+    }
+    for (int level = (*index).levels - 1; level >= 0; --level)
+    {
+        int *ancestors = (*index).ancestors + level * totalNumberOfVertices;
+        if (ancestors[vertex1] != ancestors[vertex2])
+        {
+            vertex1 = ancestors[vertex1];
+            vertex2 = ancestors[vertex2];
+        }
+    }
+    return (*index).ancestors[vertex1];
+}
+
+
+void printIndexedPath(Tree *pointerToTree, PathIndex *index, int vertex1, int vertex2)
+{
+    int ancestor = lowestCommonAncestor(pointerToTree, index, vertex1, vertex2);
+    printf("Path Length Between %d and %d: %d\n", vertex1, vertex2,
+           (*index).depth[vertex1] + (*index).depth[vertex2] - 2 * (*index).depth[ancestor]);
+    printf("Shortest Path Between %d and %d: ", vertex1, vertex2);
+    for (int vertex = vertex1; vertex != ancestor; vertex = (*index).ancestors[vertex])
+    {
+        printf("%d ", vertex);
+    }
+    printf("%d ", ancestor);
+    // the second half is found from its end, so it is kept and printed backwards
+    int halfLength = 0;
+    for (int vertex = vertex2; vertex != ancestor; vertex = (*index).ancestors[vertex])
+    {
+        (*index).pathBuffer[halfLength++] = vertex;
+    }
+    while (halfLength > 0)
+    {
+        printf("%d ", (*index).pathBuffer[--halfLength]);
+    }
+    printf("\n");
+}
+
+
+int answerQueryFile(const char *graphFilePath, const char *queryFilePath)
+{
+    FILE *inputFilePointer = fopen(graphFilePath, "r");
+    FILE *queryFilePointer = fopen(queryFilePath, "r");
+    if (inputFilePointer == NULL || queryFilePointer == NULL)
+    {
+        if (inputFilePointer != NULL)
+        {
+            fclose(inputFilePointer);
+        }
+        if (queryFilePointer != NULL)
+        {
+            fclose(queryFilePointer);
+        }
+        fprintf(stderr, "%s", INPUT_ERROR);
+        return 1;
+    }
+    Tree *pointerToTree = createATree(inputFilePointer, 0, 0);
+    fclose(inputFilePointer);
+    if (pointerToTree == NULL)
+    {
+        fclose(queryFilePointer);
+        return 1;
+    }
+    PathIndex index;
+    index.depth = NULL;
+    index.pathBuffer = NULL;
+    index.ancestors = NULL;
+    int built = (fillToNonDirectedTree(pointerToTree) < 0) ? -1 : buildPathIndex(pointerToTree, &index);
+    if (built < 0)
+    {
+        fclose(queryFilePointer);
+        freePathIndex(&index);
+        freeVertexTree(pointerToTree);
+        pointerToTree = NULL;
+        fprintf(stderr, "%s", built == -1 ? MEMORY_ERROR : NOT_A_TREE_ERROR);
+        return 1;
+    }
+    size_t length = 0;
+    int mapped = 0;
+    char *queries = loadGraphFile(queryFilePointer, &length, &mapped);
+    fclose(queryFilePointer);
+    int status = (queries == NULL);
+    const char *lineBegin = queries;
+    const char *queriesEnd = queries + length;
+    while (status == 0 && lineBegin < queriesEnd)
+    {
+        const char *lineEnd = memchr(lineBegin, '\n', queriesEnd - lineBegin);
+        lineEnd = (lineEnd == NULL) ? queriesEnd : lineEnd;
+        const char *cursor = lineBegin;
+        long vertex1 = parseNextNumber(&cursor, lineEnd);
+        long vertex2 = parseNextNumber(&cursor, lineEnd);
+        if (vertex1 == -1 && cursor == lineEnd)
+        {
+            // blank lines are skipped
+        }
+        else if (!parseLine(lineBegin, lineEnd) || vertex1 < 0 || vertex2 < 0 ||
+                 parseNextNumber(&cursor, lineEnd) != -1 || vertex1 >= (*pointerToTree).totalNumberOfVertices ||
+                 vertex2 >= (*pointerToTree).totalNumberOfVertices)
+        {
+            status = 1;
+        }
+        else
+        {
+            printIndexedPath(pointerToTree, &index, (int) vertex1, (int) vertex2);
+        }
+        lineBegin = (lineEnd == queriesEnd) ? queriesEnd : lineEnd + 1;
+    }
+    if (queries != NULL)
+    {
+        releaseGraphFile(queries, length, mapped);
+    }
+    freePathIndex(&index);
+    freeVertexTree(pointerToTree);
+    pointerToTree = NULL;
+    if (status != 0)
+    {
+        fprintf(stderr, "%s", INPUT_ERROR);
+    }
+    return status;
 }
\ No newline at end of file